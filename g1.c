@@ -5,27 +5,89 @@
  - Flexible subjects (saved to subjects.cfg)
  - Add / Display / Search / Update / Delete students
  - Duplicate roll prevention
- - Sorting & Ranking (roll, name, percentage)
+ - Sorting & Ranking (roll, name, percentage); top-K ranking in one pass
+   with a bounded heap, ties broken by roll number; full sorts radix-sort
+   compact (key, index) arrays with a parallel merge
  - Pagination (5 records per page)
- - Report card generation (reports/report_roll_<roll>.txt)
- - Backup & restore
- - Analytics & statistics
- - Colored UI (ANSI escape codes)
+ - Report card generation (reports/report_roll_<roll>.txt), single or for
+   the whole class in parallel, filtered by grade and roll range
+ - Backup & restore: zero-copy full backups, incremental block deltas
+   with a manifest, restore replays the chain; optional built-in LZ
+   compression in checksummed blocks
+ - Analytics & statistics from an incrementally maintained sidecar
+   (student.sta); median, quartiles, deciles, standard deviation and
+   histograms per subject, exact by introselect or from mergeable KLL
+   quantile sketches (student.qsk) for very large classes
+ - Optional log-structured storage engine (student.log): appends only,
+   in-memory state replayed from the last checkpoint, group-commit fsync
+ - Partitioned scans on a thread pool (analytics columns, name search);
+   POSIX builds link with -pthread
+ - Colored UI (ANSI escape codes), screens drawn with one write each
  - All data in student.dat (binary)
+ - Roll-number hash index (student.idx) for O(1) lookups
+ - In-place record updates, crash-safe via a redo journal (student.jnl);
+   the data file is synced lazily, in batches and on exit
+ - Tombstone deletes with manual and automatic compaction
+ - Zero-copy, memory-mapped read path shared across menu operations
+ - Versioned data file: schema header, records sized to the subject count,
+   automatic migration of legacy (headerless) files
+ - Columnar marks store with SIMD (SSE2) aggregation kernels for analytics
+ - Bulk import from a text file or stdin (menu, or: g1 import <file|->)
+ - Headless command line (g1 help) with tab-separated output for scripts
+ - Synthetic data generator (g1 gen) and benchmark of every operation
+   path with latency percentiles (g1 bench)
+ - Built-in metrics: per-operation latency histograms and I/O counters
+   (records scanned, bytes, fopen calls, rewrites), summed over runs in
+   student.mtr (menu 15, g1 stats, g1 --stats <command>)
+ - Query daemon on a Unix socket (g1 serve) with a binary protocol, a
+   thin client (g1 client) and a load generator (g1 loadgen)
+ - Trigram index (student.tri) for fast name substring search
+ - Compressed grade bitmaps (student.gbm) for grade filters and counts
+ - B+tree indexes on roll, name and percentage (student_*.bpt); sorted
+   display reads only the records of the page on screen
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // copy_file_range
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/stat.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define HAVE_SSE2 1
+#endif
 
 #ifdef _WIN32
   #include <conio.h>
   #include <windows.h>
+  #include <io.h>
 #else
   #include <termios.h>
   #include <unistd.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/file.h>
+  #include <sys/types.h>
+  #include <pthread.h>
+  #include <signal.h>
+  #include <errno.h>
+  #include <sys/socket.h>
+  #include <sys/un.h>
+#endif
+#ifdef __linux__
+  #include <sys/ioctl.h>
+  #include <sys/sendfile.h>
+  #ifndef FICLONE
+    #define FICLONE _IOW(0x94, 9, int) // reflink ioctl, from <linux/fs.h>
+  #endif
 #endif
 
 // -------- CONFIG --------
@@ -33,10 +95,33 @@
 #define SUBJECTS_FILE "subjects.cfg"
 #define ADMIN_FILE "admin.cfg"
 #define BACKUP_FILE "student_backup.dat"
+#define INDEX_FILE "student.idx"
+#define JOURNAL_FILE "student.jnl"
+#define TRIGRAM_FILE "student.tri"
+#define GRADE_BITMAP_FILE "student.gbm"
+#define BTREE_ROLL_FILE "student_roll.bpt"
+#define BTREE_NAME_FILE "student_name.bpt"
+#define BTREE_PERC_FILE "student_perc.bpt"
+#define STATS_FILE "student.sta"
+#define SKETCH_FILE "student.qsk"     // quantile sketches (g1 distribution --approx)
+#define LOG_FILE "student.log"
+#define LOG_LOCK_FILE "student.lck"    // held by the process appending to LOG_FILE
+#define STORAGE_FILE "storage.cfg"     // "log" selects the log-structured engine
+#define SOCKET_FILE "student.sock"     // g1 serve / g1 client
+#define BENCH_DIR "g1-bench"           // scratch directory of g1 bench
+#define METRICS_FILE "student.mtr"     // operation metrics, summed over runs
 #define REPORTS_DIR "reports"
 #define MAX_NAME_LEN 100
 #define MAX_SUBJECTS 10
+#define SUBJECT_NAME_LEN 50
+#define DATA_MAGIC "SRMS"
+#define DATA_VERSION 1
+#define DATA_HEADER_SIZE 1024     // header is padded to this many bytes
+#define LEGACY_SUFFIX ".legacy"   // original file kept after migration
 #define RECORDS_PER_PAGE 5
+#define DELETED_GRADE 'X'        // grade of a tombstoned record slot
+#define COMPACT_MIN_TOMBSTONES 64
+#define COMPACT_TOMBSTONE_RATIO 4 // auto-compact once 1/4 of slots are dead
 
 // Color codes (ANSI)
 #define COL_RESET "\033[0m"
@@ -45,8 +130,11 @@
 #define COL_YELLOW "\033[1;33m"
 #define COL_BLUE  "\033[1;34m"
 #define COL_CYAN  "\033[1;36m"
+#define ANSI_CLEAR "\033[H\033[2J"
 
 // -------- DATA STRUCTURES --------
+// In-memory record used while editing. This is also the legacy (headerless)
+// on-disk layout that migrate_legacy_file() converts from.
 typedef struct {
     int rollNo;
     char name[MAX_NAME_LEN];
@@ -56,8 +144,36 @@ typedef struct {
     char grade;
 } Student;
 
+// On-disk record of DATA_FILE (format version 1). Fixed fields come first
+// so marks[] can hold exactly the file's subject count.
+typedef struct {
+    int32_t rollNo;
+    float total;
+    float percentage;
+    char grade;
+    char reserved[3];
+    char name[MAX_NAME_LEN];
+    float marks[];      // subject_count entries
+} StudentRec;
+
+#define MAX_RECORD_SIZE (offsetof(StudentRec, marks) + MAX_SUBJECTS * sizeof(float))
+
+// Start of DATA_FILE, zero-padded to DATA_HEADER_SIZE bytes.
+typedef struct {
+    char magic[4];          // DATA_MAGIC
+    uint32_t version;       // DATA_VERSION
+    uint32_t header_size;   // DATA_HEADER_SIZE
+    uint32_t record_size;   // bytes per StudentRec slot
+    uint32_t subject_count;
+    uint32_t name_len;      // MAX_NAME_LEN
+    char subject_names[MAX_SUBJECTS][SUBJECT_NAME_LEN];
+} DataHeader;
+
 int SUBJECT_COUNT = 3; // default
-char SUBJECT_NAMES[MAX_SUBJECTS][50];
+char SUBJECT_NAMES[MAX_SUBJECTS][SUBJECT_NAME_LEN];
+int RECORD_SIZE = 0;   // set by set_record_layout()
+
+int is_deleted(const StudentRec *s) { return s->grade == DELETED_GRADE; }
 
 // -------- CROSS-PLATFORM getch (masked input) --------
 int getch_noecho() {
@@ -84,16 +200,72 @@ void sleep_ms(int ms) {
 #endif
 }
 
-// -------- UTILS --------
-void clear_screen() {
+// -------- SCREEN RENDERING --------
+// Screens that draw many lines (menus, record tables) are assembled in a
+// frame buffer and written with a single syscall by fb_flush(). Anything
+// already printed through stdio is flushed first, so the two can be mixed
+// as long as nothing is printf'd while a frame is being built.
+struct {
+    char *buf;
+    size_t len, cap;
+} g_frame;
+
+void fb_printf(const char *fmt, ...) {
+    va_list ap;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        size_t room = g_frame.cap - g_frame.len;
+        va_start(ap, fmt);
+        int n = vsnprintf(g_frame.buf ? g_frame.buf + g_frame.len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) return;
+        if ((size_t)n < room) { g_frame.len += n; return; }
+        size_t cap = g_frame.cap ? g_frame.cap : 8192;
+        while (cap - g_frame.len <= (size_t)n) cap *= 2;
+        char *grown = realloc(g_frame.buf, cap);
+        if (!grown) return;
+        g_frame.buf = grown;
+        g_frame.cap = cap;
+    }
+}
+
+void fb_flush() {
+    fflush(stdout);
+    size_t off = 0;
+    while (off < g_frame.len) {
 #ifdef _WIN32
-    system("cls");
+        int n = _write(1, g_frame.buf + off, (unsigned)(g_frame.len - off));
 #else
-    system("clear");
+        ssize_t n = write(STDOUT_FILENO, g_frame.buf + off, g_frame.len - off);
+#endif
+        if (n <= 0) break;
+        off += (size_t)n;
+    }
+    g_frame.len = 0;
+}
+
+// Start a new frame with the screen cleared.
+void fb_clear() {
+    fb_printf(ANSI_CLEAR);
+}
+
+// Windows consoles only interpret ANSI escapes once VT processing is on.
+void enable_ansi_terminal() {
+#ifdef _WIN32
+    HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+    if (h != INVALID_HANDLE_VALUE && GetConsoleMode(h, &mode))
+        SetConsoleMode(h, mode | 0x0004 /* ENABLE_VIRTUAL_TERMINAL_PROCESSING */);
 #endif
 }
 
+// -------- UTILS --------
+void clear_screen() {
+    fb_flush();
+    fputs(ANSI_CLEAR, stdout);
+}
+
 void pause_anykey() {
+    fb_flush();
     printf("\n---------------------------------------------------------\n");
     printf("Press ENTER to continue...");
     getchar();
@@ -120,15 +292,630 @@ void safe_fgets(char *buf, int n) {
     }
 }
 
+uint32_t fnv1a(uint32_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; ++i) { h ^= p[i]; h *= 16777619u; }
+    return h;
+}
+
+int sync_file(FILE *fp) {
+    if (fflush(fp) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(fp)) == 0;
+#else
+    return fsync(fileno(fp)) == 0;
+#endif
+}
+
+double monotonic_seconds() {
+#ifdef _WIN32
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart / (double)f.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
 // Create reports dir
 void ensure_reports_dir() {
 #ifdef _WIN32
     CreateDirectoryA(REPORTS_DIR, NULL);
 #else
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "mkdir -p %s", REPORTS_DIR);
-    system(cmd);
+    mkdir(REPORTS_DIR, 0755); // EEXIST is fine
+#endif
+}
+
+// -------- METRICS (operation latencies & I/O counters) --------
+// Each core operation records its latency in a log-linear (HDR-style)
+// histogram: below 2^METRIC_SUB_BITS ns every value has its own bucket,
+// above that each power of two is split into 2^METRIC_SUB_BITS buckets,
+// so percentiles are within ~6% of the exact value. I/O counters are
+// charged to the innermost operation running on the thread (pool workers
+// take the caller's). Totals accumulate across runs in METRICS_FILE,
+// which is updated on exit; `g1 stats` and menu 15 print them.
+#define METRIC_SUB_BITS 4
+#define METRIC_SUB (1 << METRIC_SUB_BITS)
+#define METRIC_MAX_BITS 44          // ~4.9 hours in ns; longer samples are clamped
+#define METRIC_BUCKETS ((METRIC_MAX_BITS - METRIC_SUB_BITS + 1) * METRIC_SUB)
+#define METRIC_NAME_LEN 24
+
+#ifdef _MSC_VER
+  #define THREAD_LOCAL __declspec(thread)
+#else
+  #define THREAD_LOCAL _Thread_local
+#endif
+
+enum {
+    MOP_OTHER, MOP_ROLL_EXISTS, MOP_ADD, MOP_IMPORT, MOP_UPDATE, MOP_DELETE,
+    MOP_FIND_ROLL, MOP_FIND_NAME, MOP_FIND_GRADE, MOP_LIST, MOP_RANK,
+    MOP_ANALYTICS, MOP_COLUMNS, MOP_REWRITE, MOP_INDEX_REBUILD, MOP_JOURNAL_FLUSH,
+    MOP_CHECKPOINT, MOP_BACKUP, MOP_BACKUP_INCR, MOP_RESTORE, MOP_REPORT,
+    MOP_REPORTS, MOP_DISTRIBUTION, METRIC_OPS
+};
+const char *METRIC_OP_NAMES[METRIC_OPS] = {
+    "other", "roll_exists", "add", "import", "update", "delete",
+    "find_roll", "find_name", "find_grade", "list", "rank",
+    "analytics", "columns_build", "rewrite", "index_rebuild", "journal_flush",
+    "checkpoint", "backup", "backup_incremental", "restore", "report",
+    "reports_batch", "distribution"
+};
+
+enum { MC_SCANNED, MC_BYTES_READ, MC_BYTES_WRITTEN, MC_FOPEN, MC_REWRITES, METRIC_COUNTERS };
+const char *METRIC_COUNTER_NAMES[METRIC_COUNTERS] = {
+    "records_scanned", "bytes_read", "bytes_written", "fopen", "rewrites"
+};
+
+typedef struct {
+    uint64_t count, sum_ns, max_ns;
+    uint64_t counters[METRIC_COUNTERS];
+    uint64_t buckets[METRIC_BUCKETS];
+} OpMetrics;
+
+typedef struct {
+    OpMetrics op[METRIC_OPS];
+} Metrics;
+
+typedef struct {
+    char magic[4];          // "SMTR"
+    uint32_t version;
+    uint32_t ops;           // entries that follow: name[METRIC_NAME_LEN] + OpMetrics
+    uint32_t counters;
+    uint32_t buckets;
+} MetricsFileHeader;
+
+Metrics g_metrics;
+THREAD_LOCAL int g_metric_op;   // innermost running operation, MOP_OTHER outside
+int g_metrics_dump;             // g1 --stats: print this run's metrics on exit
+
+void metric_add(uint64_t *p, uint64_t n) {
+#if defined(__GNUC__)
+    __atomic_fetch_add(p, n, __ATOMIC_RELAXED);
+#elif defined(_WIN32)
+    InterlockedExchangeAdd64((volatile LONG64 *)p, (LONG64)n);
+#else
+    *p += n;
+#endif
+}
+
+void metric_max(uint64_t *p, uint64_t v) {
+#if defined(__GNUC__)
+    uint64_t cur = __atomic_load_n(p, __ATOMIC_RELAXED);
+    while (v > cur && !__atomic_compare_exchange_n(p, &cur, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+#elif defined(_WIN32)
+    LONG64 cur = *(volatile LONG64 *)p;
+    while ((LONG64)v > cur) {
+        LONG64 seen = InterlockedCompareExchange64((volatile LONG64 *)p, (LONG64)v, cur);
+        if (seen == cur) break;
+        cur = seen;
+    }
+#else
+    if (v > *p) *p = v;
+#endif
+}
+
+// Charge n to a counter of the running operation.
+void metric_count(int counter, uint64_t n) {
+    metric_add(&g_metrics.op[g_metric_op].counters[counter], n);
+}
+
+int metric_bucket(uint64_t ns) {
+    if (ns < METRIC_SUB) return (int)ns;
+#ifdef __GNUC__
+    int msb = 63 - __builtin_clzll(ns);
+#else
+    int msb = 0;
+    while (ns >> (msb + 1)) msb++;
+#endif
+    if (msb >= METRIC_MAX_BITS) return METRIC_BUCKETS - 1;
+    int shift = msb - METRIC_SUB_BITS;
+    return (shift + 1) * METRIC_SUB + (int)((ns >> shift) - METRIC_SUB);
+}
+
+// Largest value that falls into bucket b.
+uint64_t metric_bucket_high(int b) {
+    if (b < METRIC_SUB) return (uint64_t)b;
+    int shift = b / METRIC_SUB - 1;
+    return ((uint64_t)(METRIC_SUB + b % METRIC_SUB + 1) << shift) - 1;
+}
+
+typedef struct {
+    int op, outer;
+    double start;
+} MetricScope;
+
+void metric_begin(MetricScope *m, int op) {
+    m->op = op;
+    m->outer = g_metric_op;
+    g_metric_op = op;
+    m->start = monotonic_seconds();
+}
+
+// Record the operation's latency and return rc, so `return X;` in an
+// instrumented function becomes `return metric_end(&m, X);`.
+int metric_end(MetricScope *m, int rc) {
+    double secs = monotonic_seconds() - m->start;
+    uint64_t ns = secs > 0 ? (uint64_t)(secs * 1e9) : 0;
+    OpMetrics *o = &g_metrics.op[m->op];
+    metric_add(&o->count, 1);
+    metric_add(&o->sum_ns, ns);
+    metric_max(&o->max_ns, ns);
+    metric_add(&o->buckets[metric_bucket(ns)], 1);
+    g_metric_op = m->outer;
+    return rc;
+}
+
+// Value at quantile q (0..1) of an operation's latencies, in ns.
+uint64_t metric_percentile(const OpMetrics *o, double q) {
+    if (o->count == 0) return 0;
+    uint64_t want = (uint64_t)(q * (double)o->count + 0.999999);
+    if (want < 1) want = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < METRIC_BUCKETS; ++b) {
+        seen += o->buckets[b];
+        if (seen >= want) {
+            uint64_t v = metric_bucket_high(b);
+            return v < o->max_ns ? v : o->max_ns;
+        }
+    }
+    return o->max_ns;
+}
+
+// Metered stdio: every file access below goes through these.
+FILE *io_fopen(const char *path, const char *mode) {
+    metric_count(MC_FOPEN, 1);
+    return fopen(path, mode);
+}
+
+size_t io_fread(void *p, size_t size, size_t n, FILE *fp) {
+    size_t got = fread(p, size, n, fp);
+    metric_count(MC_BYTES_READ, (uint64_t)got * size);
+    return got;
+}
+
+size_t io_fwrite(const void *p, size_t size, size_t n, FILE *fp) {
+    size_t put = fwrite(p, size, n, fp);
+    metric_count(MC_BYTES_WRITTEN, (uint64_t)put * size);
+    return put;
+}
+
+// Move `from` over `to`, replacing it atomically: a crash or a failure
+// leaves one of the two files whole. Returns 0 on success, like rename().
+int replace_file(const char *from, const char *to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(from, to);
+#endif
+}
+
+// Exclusive advisory lock on an open file, held across a choose-offset-
+// then-write sequence that another process could interleave with. A no-op
+// on Windows, where there is no daemon to race.
+void file_lock(FILE *fp) {
+#ifndef _WIN32
+    while (flock(fileno(fp), LOCK_EX) != 0 && errno == EINTR) {}
+#else
+    (void)fp;
+#endif
+}
+
+void file_unlock(FILE *fp) {
+#ifndef _WIN32
+    flock(fileno(fp), LOCK_UN);
+#else
+    (void)fp;
+#endif
+}
+
+// Name of a scratch file next to path, private to this process, to build
+// a replacement in before replace_file() publishes it. Readers in other
+// processes never see a half-written file.
+void temp_path(const char *path, char *out, size_t n) {
+#ifdef _WIN32
+    snprintf(out, n, "%s.%lu.tmp", path, (unsigned long)GetCurrentProcessId());
+#else
+    snprintf(out, n, "%s.%ld.tmp", path, (long)getpid());
+#endif
+}
+
+void metrics_merge(Metrics *dst, const Metrics *src) {
+    for (int i = 0; i < METRIC_OPS; ++i) {
+        OpMetrics *d = &dst->op[i];
+        const OpMetrics *s = &src->op[i];
+        d->count += s->count;
+        d->sum_ns += s->sum_ns;
+        if (s->max_ns > d->max_ns) d->max_ns = s->max_ns;
+        for (int c = 0; c < METRIC_COUNTERS; ++c) d->counters[c] += s->counters[c];
+        for (int b = 0; b < METRIC_BUCKETS; ++b) d->buckets[b] += s->buckets[b];
+    }
+}
+
+// Add the totals saved in METRICS_FILE to *m. Entries are matched by
+// operation name; a file with a different bucket layout is ignored.
+int metrics_load(Metrics *m) {
+    FILE *fp = fopen(METRICS_FILE, "rb");
+    if (!fp) return 0;
+    MetricsFileHeader h;
+    int ok = fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, "SMTR", 4) == 0 && h.version == 1 &&
+             h.counters == METRIC_COUNTERS && h.buckets == METRIC_BUCKETS;
+    Metrics *file = ok ? calloc(1, sizeof(*file)) : NULL;
+    for (uint32_t i = 0; file && i < h.ops; ++i) {
+        char name[METRIC_NAME_LEN];
+        OpMetrics o;
+        if (fread(name, sizeof(name), 1, fp) != 1 || fread(&o, sizeof(o), 1, fp) != 1) break;
+        name[sizeof(name) - 1] = '\0';
+        for (int k = 0; k < METRIC_OPS; ++k) {
+            if (strcmp(name, METRIC_OP_NAMES[k]) == 0) { file->op[k] = o; break; }
+        }
+    }
+    fclose(fp);
+    if (file) metrics_merge(m, file);
+    free(file);
+    return ok;
+}
+
+// Fold *session into METRICS_FILE. Concurrent processes may lose each
+// other's last run; the totals are statistics, not accounts.
+int metrics_save(const Metrics *session) {
+    Metrics *m = calloc(1, sizeof(*m));
+    if (!m) return 0;
+    metrics_load(m);
+    metrics_merge(m, session);
+    MetricsFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "SMTR", 4);
+    h.version = 1;
+    h.ops = METRIC_OPS;
+    h.counters = METRIC_COUNTERS;
+    h.buckets = METRIC_BUCKETS;
+    FILE *fp = fopen("temp.mtr", "wb");
+    int ok = fp && fwrite(&h, sizeof(h), 1, fp) == 1;
+    for (int i = 0; ok && i < METRIC_OPS; ++i) {
+        char name[METRIC_NAME_LEN] = {0};
+        snprintf(name, sizeof(name), "%s", METRIC_OP_NAMES[i]);
+        ok = fwrite(name, sizeof(name), 1, fp) == 1 && fwrite(&m->op[i], sizeof(OpMetrics), 1, fp) == 1;
+    }
+    if (fp) ok = (fclose(fp) == 0) && ok;
+    free(m);
+    if (ok) ok = replace_file("temp.mtr", METRICS_FILE) == 0;
+    if (!ok) remove("temp.mtr");
+    return ok;
+}
+
+// One row per operation that ran or did I/O: tab-separated for scripts,
+// aligned columns for the menu. Latencies in microseconds.
+void metrics_print(FILE *out, const Metrics *m, int tsv) {
+    static const char *cols[] = { "op", "count", "total_ms", "mean_us", "p50_us", "p90_us", "p99_us",
+                                  "p99.9_us", "max_us", "scanned", "read_kb", "written_kb", "fopen", "rewrites" };
+    static const int width[] = { -18, 9, 10, 9, 9, 9, 9, 9, 10, 10, 10, 10, 7, 8 };
+    int ncols = (int)(sizeof(cols) / sizeof(cols[0]));
+    for (int c = 0; c < ncols; ++c) {
+        if (tsv) fprintf(out, "%s%s", c ? "\t" : "", cols[c]);
+        else fprintf(out, "%s%*s", c ? " " : "", width[c], cols[c]);
+    }
+    fputc('\n', out);
+    for (int i = 0; i < METRIC_OPS; ++i) {
+        const OpMetrics *o = &m->op[i];
+        int used = o->count > 0;
+        for (int c = 0; c < METRIC_COUNTERS; ++c) used |= o->counters[c] > 0;
+        if (!used) continue;
+        char cell[14][32];
+        snprintf(cell[0], 32, "%s", METRIC_OP_NAMES[i]);
+        snprintf(cell[1], 32, "%llu", (unsigned long long)o->count);
+        snprintf(cell[2], 32, "%.1f", o->sum_ns / 1e6);
+        snprintf(cell[3], 32, "%.1f", o->count ? o->sum_ns / 1e3 / o->count : 0.0);
+        const double qs[] = { 0.50, 0.90, 0.99, 0.999 };
+        for (int q = 0; q < 4; ++q) snprintf(cell[4 + q], 32, "%.1f", metric_percentile(o, qs[q]) / 1e3);
+        snprintf(cell[8], 32, "%.1f", o->max_ns / 1e3);
+        snprintf(cell[9], 32, "%llu", (unsigned long long)o->counters[MC_SCANNED]);
+        snprintf(cell[10], 32, "%llu", (unsigned long long)(o->counters[MC_BYTES_READ] / 1024));
+        snprintf(cell[11], 32, "%llu", (unsigned long long)(o->counters[MC_BYTES_WRITTEN] / 1024));
+        snprintf(cell[12], 32, "%llu", (unsigned long long)o->counters[MC_FOPEN]);
+        snprintf(cell[13], 32, "%llu", (unsigned long long)o->counters[MC_REWRITES]);
+        for (int c = 0; c < ncols; ++c) {
+            if (tsv) fprintf(out, "%s%s", c ? "\t" : "", cell[c]);
+            else fprintf(out, "%s%*s", c ? " " : "", width[c], cell[c]);
+        }
+        fputc('\n', out);
+    }
+}
+
+// atexit: fold this run into METRICS_FILE if it did any operation.
+void metrics_at_exit() {
+    int ran = 0;
+    for (int i = 0; i < METRIC_OPS; ++i) ran |= g_metrics.op[i].count > 0;
+    if (g_metrics_dump) metrics_print(stderr, &g_metrics, 1);
+    if (ran) metrics_save(&g_metrics);
+}
+
+// -------- THREAD POOL & PARALLEL SCANS --------
+// A fixed pool of worker threads, started on first use, runs the parts of
+// a partitioned scan; the calling thread works on parts too. Part i of n
+// items always covers [n*i/parts, n*(i+1)/parts), so callers merging their
+// per-part results in part order get the same answer as a serial scan.
+// Without POSIX threads (Windows builds) the parts run serially.
+#define POOL_MAX_THREADS 64
+#define SCAN_MIN_CHUNK 16384     // smallest part worth a thread
+
+typedef void (*RangeFn)(void *arg, int part, int begin, int end);
+
+typedef struct {
+    RangeFn fn;
+    void *arg;
+    int n;
+    int parts;
+    int metric_op;          // operation of the caller, charged for the I/O of every part
+} ScanJob;
+
+void scan_run_part(const ScanJob *job, int part) {
+    int begin = (int)((long long)job->n * part / job->parts);
+    int end = (int)((long long)job->n * (part + 1) / job->parts);
+    int outer = g_metric_op;
+    g_metric_op = job->metric_op;
+    job->fn(job->arg, part, begin, end);
+    g_metric_op = outer;
+}
+
+#ifndef _WIN32
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;        // a new job was posted
+    pthread_cond_t done;        // all parts of the job finished
+    int started;                // worker threads running
+    unsigned batch;             // bumped for every job
+    const ScanJob *job;
+    int next;                   // next unclaimed part
+    int finished;
+} ThreadPool;
+
+ThreadPool g_pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, NULL, 0, 0 };
+
+// Claim and run parts of the current job until none are left. Called
+// with the pool lock held; returns with it held.
+void pool_drain() {
+    while (g_pool.job && g_pool.next < g_pool.job->parts) {
+        const ScanJob *job = g_pool.job;
+        int part = g_pool.next++;
+        pthread_mutex_unlock(&g_pool.lock);
+        scan_run_part(job, part);
+        pthread_mutex_lock(&g_pool.lock);
+        if (++g_pool.finished == job->parts) pthread_cond_broadcast(&g_pool.done);
+    }
+}
+
+void *pool_worker(void *unused) {
+    (void)unused;
+    unsigned seen = 0;
+    pthread_mutex_lock(&g_pool.lock);
+    while (1) {
+        while (g_pool.batch == seen) pthread_cond_wait(&g_pool.wake, &g_pool.lock);
+        seen = g_pool.batch;
+        pool_drain();
+    }
+    return NULL;
+}
+#endif
+
+// Worker threads to use: the online CPUs, or G1_THREADS if set.
+int pool_threads() {
+    static int threads = 0;
+    if (threads) return threads;
+    const char *env = getenv("G1_THREADS");
+    if (env && atoi(env) > 0) threads = atoi(env);
+#ifdef _WIN32
+    if (!threads) threads = 1;
+#else
+    if (!threads) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (threads < 1) threads = 1;
+    if (threads > POOL_MAX_THREADS) threads = POOL_MAX_THREADS;
+    return threads;
+}
+
+// Number of parts a scan of n items should be split into: one per thread,
+// but no part smaller than min_chunk (and at least one part).
+int parallel_parts(int n, int min_chunk) {
+    int parts = pool_threads();
+    if (min_chunk > 0 && n / min_chunk < parts) parts = n / min_chunk;
+    return parts < 1 ? 1 : parts;
+}
+
+// Run fn over `parts` contiguous parts of [0, n) and wait for all of them.
+// Not reentrant: fn must not start another parallel_for. Calls from
+// several threads (daemon readers) take turns on the pool.
+void parallel_for(int n, int parts, RangeFn fn, void *arg) {
+    ScanJob job = { fn, arg, n, parts < 1 ? 1 : parts, g_metric_op };
+#ifndef _WIN32
+    if (job.parts > 1) {
+        pthread_mutex_lock(&g_pool.lock);
+        while (g_pool.job) pthread_cond_wait(&g_pool.done, &g_pool.lock);
+        while (g_pool.started < pool_threads() - 1) {
+            pthread_t t;
+            if (pthread_create(&t, NULL, pool_worker, NULL) != 0) break;
+            pthread_detach(t);
+            g_pool.started++;
+        }
+        g_pool.job = &job;
+        g_pool.next = 0;
+        g_pool.finished = 0;
+        g_pool.batch++;
+        pthread_cond_broadcast(&g_pool.wake);
+        pool_drain();
+        while (g_pool.finished < job.parts) pthread_cond_wait(&g_pool.done, &g_pool.lock);
+        g_pool.job = NULL;
+        pthread_cond_broadcast(&g_pool.done); // wake the next caller waiting its turn
+        pthread_mutex_unlock(&g_pool.lock);
+        return;
+    }
 #endif
+    for (int part = 0; part < job.parts; ++part) scan_run_part(&job, part);
+}
+
+// -------- RADIX SORT (key, index arrays) --------
+// Record sorts work on compact (key, index) pairs instead of moving
+// records under a comparator. The pairs get an LSD radix sort on the
+// 64-bit key: one histogram pass, then one scatter for each byte that
+// actually varies. The sort is stable, so equal keys keep their input
+// order. Longer keys (names) supply more 64-bit chunks on demand, and
+// runs that tie on one chunk are refined by the next. Large inputs are
+// sorted in parts on the thread pool, then merged pairwise in parallel
+// rounds.
+#define RADIX_SMALL 48            // insertion sort below this
+#define RADIX_MIN_CHUNK 65536     // smallest part worth a thread
+
+typedef struct {
+    uint64_t key;
+    int32_t idx;
+} SortKey;
+
+// Chunk `depth` (1, 2, ...) of the key of item idx; chunk 0 is in key.
+// Long keys are zero-padded strings: once a chunk ends in a zero byte,
+// the chunks after it are all zero and are never asked for.
+typedef uint64_t (*KeyChunkFn)(void *arg, int32_t idx, int depth);
+
+void insertion_sort_keys(SortKey *a, int n) {
+    for (int i = 1; i < n; ++i) {
+        SortKey x = a[i];
+        int j = i;
+        while (j > 0 && a[j - 1].key > x.key) { a[j] = a[j - 1]; j--; }
+        a[j] = x;
+    }
+}
+
+// Stable sort of a[0..n) on key, with tmp[0..n) as scratch.
+void radix_sort_keys(SortKey *a, SortKey *tmp, int n) {
+    if (n < RADIX_SMALL) { insertion_sort_keys(a, n); return; }
+    uint32_t count[8][256];
+    memset(count, 0, sizeof(count));
+    for (int i = 0; i < n; ++i) {
+        uint64_t k = a[i].key;
+        for (int b = 0; b < 8; ++b) count[b][(k >> (8 * b)) & 255]++;
+    }
+    SortKey *src = a, *dst = tmp;
+    for (int b = 0; b < 8; ++b) {
+        uint32_t *c = count[b];
+        if (c[(src[0].key >> (8 * b)) & 255] == (uint32_t)n) continue; // same byte everywhere
+        uint32_t sum = 0;
+        for (int d = 0; d < 256; ++d) { uint32_t t = c[d]; c[d] = sum; sum += t; }
+        for (int i = 0; i < n; ++i) dst[c[(src[i].key >> (8 * b)) & 255]++] = src[i];
+        SortKey *t = src; src = dst; dst = t;
+    }
+    if (src != a) memcpy(a, src, sizeof(SortKey) * n);
+}
+
+// a[0..n) is sorted on chunk depth-1, held in key: order each run of equal
+// keys by the chunks that follow. The run's keys are restored afterwards.
+void refine_ties(SortKey *a, SortKey *tmp, int n, KeyChunkFn more, void *arg, int depth, int depths) {
+    if (!more || depth >= depths) return;
+    for (int i = 0; i < n;) {
+        int j = i + 1;
+        while (j < n && a[j].key == a[i].key) j++;
+        if (j - i > 1 && (a[i].key & 255) != 0) {
+            uint64_t k = a[i].key;
+            for (int t = i; t < j; ++t) a[t].key = more(arg, a[t].idx, depth);
+            radix_sort_keys(a + i, tmp + i, j - i);
+            refine_ties(a + i, tmp + i, j - i, more, arg, depth + 1, depths);
+            for (int t = i; t < j; ++t) a[t].key = k;
+        }
+        i = j;
+    }
+}
+
+int sort_key_compare(const SortKey *x, const SortKey *y, KeyChunkFn more, void *arg, int depths) {
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    uint64_t last = x->key;
+    for (int d = 1; more && d < depths && (last & 255) != 0; ++d) {
+        uint64_t p = more(arg, x->idx, d), q = more(arg, y->idx, d);
+        if (p != q) return p < q ? -1 : 1;
+        last = p;
+    }
+    return 0;
+}
+
+typedef struct {
+    SortKey *a, *tmp;
+    int n;
+    KeyChunkFn more;
+    void *arg;
+    int depths;
+    int parts;
+    int width;              // merge round: runs span this many parts
+    SortKey *src, *dst;
+} KeySort;
+
+int key_part_begin(const KeySort *s, int part) {
+    return (int)((long long)s->n * part / s->parts);
+}
+
+void key_sort_part(void *arg, int part, int begin, int end) {
+    KeySort *s = arg;
+    (void)part;
+    radix_sort_keys(s->a + begin, s->tmp + begin, end - begin);
+    refine_ties(s->a + begin, s->tmp + begin, end - begin, s->more, s->arg, 1, s->depths);
+}
+
+// Merge the two runs of pair `pair` from src into dst; a lone run is copied.
+void key_merge_part(void *arg, int pair, int begin, int end) {
+    KeySort *s = arg;
+    (void)begin; (void)end;
+    int lo_part = 2 * s->width * pair;
+    int mid_part = lo_part + s->width < s->parts ? lo_part + s->width : s->parts;
+    int hi_part = lo_part + 2 * s->width < s->parts ? lo_part + 2 * s->width : s->parts;
+    int i = key_part_begin(s, lo_part), mid = key_part_begin(s, mid_part);
+    int j = mid, hi = key_part_begin(s, hi_part), k = i;
+    while (i < mid && j < hi) // ties take the left run: stable
+        s->dst[k++] = sort_key_compare(&s->src[j], &s->src[i], s->more, s->arg, s->depths) < 0 ? s->src[j++] : s->src[i++];
+    while (i < mid) s->dst[k++] = s->src[i++];
+    while (j < hi) s->dst[k++] = s->src[j++];
+}
+
+// Stable sort of a[0..n) by key and then chunks 1..depths-1 of `more`
+// (NULL when the key is complete). Returns 0 when out of memory.
+int sort_keys(SortKey *a, int n, KeyChunkFn more, void *arg, int depths) {
+    if (n < 2) return 1;
+    SortKey *tmp = malloc(sizeof(SortKey) * n);
+    if (!tmp) return 0;
+    KeySort s = { a, tmp, n, more, arg, depths, parallel_parts(n, RADIX_MIN_CHUNK), 1, a, tmp };
+    parallel_for(n, s.parts, key_sort_part, &s);
+    for (; s.width < s.parts; s.width *= 2) {
+        int pairs = (s.parts + 2 * s.width - 1) / (2 * s.width);
+        parallel_for(pairs, pairs, key_merge_part, &s);
+        SortKey *t = s.src; s.src = s.dst; s.dst = t;
+    }
+    if (s.src != a) memcpy(a, s.src, sizeof(SortKey) * n);
+    free(tmp);
+    return 1;
 }
 
 // -------- WELCOME SCREEN --------
@@ -152,7 +939,7 @@ void show_welcome_screen() {
 
 // -------- SUBJECTS MANAGEMENT --------
 void load_subjects() {
-    FILE *fp = fopen(SUBJECTS_FILE, "r");
+    FILE *fp = io_fopen(SUBJECTS_FILE, "r");
     if (!fp) {
         SUBJECT_COUNT = 3;
         strncpy(SUBJECT_NAMES[0], "Math", sizeof(SUBJECT_NAMES[0]));
@@ -176,7 +963,7 @@ void load_subjects() {
 }
 
 void save_subjects() {
-    FILE *fp = fopen(SUBJECTS_FILE, "w");
+    FILE *fp = io_fopen(SUBJECTS_FILE, "w");
     if (!fp) {
         printf(COL_RED "Error writing subjects file!\n" COL_RESET);
         return;
@@ -186,6 +973,8 @@ void save_subjects() {
     fclose(fp);
 }
 
+int change_subjects(int count, char names[][SUBJECT_NAME_LEN]); // see DELETE & COMPACTION
+
 void configure_subjects() {
     printf(COL_CYAN "----- Configure Subjects (max %d) -----\n" COL_RESET, MAX_SUBJECTS);
     printf("Current subject count: %d\n", SUBJECT_COUNT);
@@ -201,23 +990,27 @@ void configure_subjects() {
         printf(COL_RED "Out of range. Aborting.\n" COL_RESET);
         return;
     }
-    SUBJECT_COUNT = n;
-    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+    char names[MAX_SUBJECTS][SUBJECT_NAME_LEN];
+    for (int i = 0; i < n; ++i) {
         printf("Enter name for subject %d: ", i+1);
-        safe_fgets(SUBJECT_NAMES[i], sizeof(SUBJECT_NAMES[i]));
-        if (strlen(SUBJECT_NAMES[i]) == 0) snprintf(SUBJECT_NAMES[i], sizeof(SUBJECT_NAMES[i]), "Subject%d", i+1);
-        to_titlecase(SUBJECT_NAMES[i]);
+        safe_fgets(names[i], sizeof(names[i]));
+        if (strlen(names[i]) == 0) snprintf(names[i], sizeof(names[i]), "Subject%d", i+1);
+        to_titlecase(names[i]);
+    }
+    if (!change_subjects(n, names)) {
+        printf(COL_RED "Error converting data file to the new subjects.\n" COL_RESET);
+        pause_anykey();
+        return;
     }
-    save_subjects();
     printf(COL_GREEN "Subjects updated and saved.\n" COL_RESET);
     pause_anykey();
 }
 
 // -------- ADMIN LOGIN & PASSWORD --------
 void ensure_admin_file() {
-    FILE *fp = fopen(ADMIN_FILE, "r");
+    FILE *fp = io_fopen(ADMIN_FILE, "r");
     if (!fp) {
-        fp = fopen(ADMIN_FILE, "w");
+        fp = io_fopen(ADMIN_FILE, "w");
         if (fp) {
             fprintf(fp, "admin\n"); // default password
             fclose(fp);
@@ -251,7 +1044,7 @@ void change_admin_password() {
         pause_anykey();
         return;
     }
-    FILE *fp = fopen(ADMIN_FILE, "w");
+    FILE *fp = io_fopen(ADMIN_FILE, "w");
     if (!fp) { printf(COL_RED "Unable to change password file.\n" COL_RESET); pause_anykey(); return; }
     fprintf(fp, "%s\n", pwd1);
     fclose(fp);
@@ -262,7 +1055,7 @@ void change_admin_password() {
 int admin_login() {
     ensure_admin_file();
     char stored[200];
-    FILE *fp = fopen(ADMIN_FILE, "r");
+    FILE *fp = io_fopen(ADMIN_FILE, "r");
     if (!fp) return 0;
     if (!fgets(stored, sizeof(stored), fp)) { fclose(fp); return 0; }
     stored[strcspn(stored, "\n")] = '\0';
@@ -292,492 +1085,5957 @@ int admin_login() {
     return 0;
 }
 
-// -------- CORE: file operations, validation --------
-int roll_exists(int roll) {
-    FILE *fp = fopen(DATA_FILE, "rb");
-    if (!fp) return 0;
-    Student s;
-    while (fread(&s, sizeof(Student), 1, fp) == 1) {
-        if (s.rollNo == roll) { fclose(fp); return 1; }
-    }
-    fclose(fp);
-    return 0;
+// -------- DATA FILE FORMAT --------
+// DATA_FILE = DataHeader (DATA_HEADER_SIZE bytes) + slots of RECORD_SIZE.
+// The header is authoritative for the subject list; subjects.cfg is kept
+// in sync with it.
+void set_record_layout() {
+    RECORD_SIZE = (int)(offsetof(StudentRec, marks) + SUBJECT_COUNT * sizeof(float));
 }
 
-void recalc_student(Student *s) {
-    s->total = 0.0f;
-    for (int i = 0; i < SUBJECT_COUNT; ++i) s->total += s->marks[i];
-    s->percentage = s->total / SUBJECT_COUNT;
-    if (s->percentage >= 90.0f) s->grade = 'A';
-    else if (s->percentage >= 75.0f) s->grade = 'B';
-    else if (s->percentage >= 60.0f) s->grade = 'C';
-    else if (s->percentage >= 40.0f) s->grade = 'D';
-    else s->grade = 'F';
+long slot_offset(int slot) {
+    return (long)DATA_HEADER_SIZE + (long)slot * (long)RECORD_SIZE;
 }
 
-// -------- ADD STUDENT --------
-void addStudent_feature() {
-    Student s;
-    clear_screen();
-    printf(COL_CYAN "----- Add Student -----\n" COL_RESET);
-
-    printf("Enter Roll Number: ");
-    if (scanf("%d", &s.rollNo) != 1) {
-        printf(COL_RED "Invalid input.\n" COL_RESET);
-        while (getchar() != '\n');
-        pause_anykey();
-        return;
-    }
-    while (getchar() != '\n');
+int header_valid(const DataHeader *h) {
+    return memcmp(h->magic, DATA_MAGIC, 4) == 0 && h->version == DATA_VERSION &&
+           h->header_size == DATA_HEADER_SIZE && h->name_len == MAX_NAME_LEN &&
+           h->subject_count >= 1 && h->subject_count <= MAX_SUBJECTS &&
+           h->record_size == offsetof(StudentRec, marks) + h->subject_count * sizeof(float);
+}
 
-    if (roll_exists(s.rollNo)) {
-        printf(COL_RED "Roll number already exists. Aborting.\n" COL_RESET);
-        pause_anykey();
-        return;
+// Adopt the subject layout of a data file header.
+void apply_header(const DataHeader *h) {
+    int changed = (int)h->subject_count != SUBJECT_COUNT;
+    SUBJECT_COUNT = (int)h->subject_count;
+    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+        if (strncmp(SUBJECT_NAMES[i], h->subject_names[i], SUBJECT_NAME_LEN) != 0) changed = 1;
+        memcpy(SUBJECT_NAMES[i], h->subject_names[i], SUBJECT_NAME_LEN);
+        SUBJECT_NAMES[i][SUBJECT_NAME_LEN - 1] = '\0';
     }
+    set_record_layout();
+    if (changed) save_subjects();
+}
 
-    printf("Enter Full Name: ");
-    safe_fgets(s.name, sizeof(s.name));
-    if (strlen(s.name) == 0) strcpy(s.name, "Unnamed Student");
-    to_titlecase(s.name);
-
+// Write a header describing the current subject layout at the start of fp.
+int write_data_header(FILE *fp) {
+    unsigned char buf[DATA_HEADER_SIZE];
+    DataHeader h;
+    memset(buf, 0, sizeof(buf));
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DATA_MAGIC, 4);
+    h.version = DATA_VERSION;
+    h.header_size = DATA_HEADER_SIZE;
+    h.record_size = (uint32_t)RECORD_SIZE;
+    h.subject_count = (uint32_t)SUBJECT_COUNT;
+    h.name_len = MAX_NAME_LEN;
     for (int i = 0; i < SUBJECT_COUNT; ++i) {
-        printf("Enter marks for %s: ", SUBJECT_NAMES[i]);
-        if (scanf("%f", &s.marks[i]) != 1) {
-            printf(COL_RED "Invalid input.\n" COL_RESET);
-            while (getchar() != '\n');
-            pause_anykey();
-            return;
-        }
+        memcpy(h.subject_names[i], SUBJECT_NAMES[i], SUBJECT_NAME_LEN);
+        h.subject_names[i][SUBJECT_NAME_LEN - 1] = '\0';
     }
-    while (getchar() != '\n');
+    memcpy(buf, &h, sizeof(h));
+    return fseek(fp, 0, SEEK_SET) == 0 && io_fwrite(buf, sizeof(buf), 1, fp) == 1;
+}
 
-    recalc_student(&s);
+// Encode s into rec (RECORD_SIZE bytes) using the current subject count.
+void student_to_rec(const Student *s, StudentRec *rec) {
+    memset(rec, 0, RECORD_SIZE);
+    rec->rollNo = s->rollNo;
+    rec->total = s->total;
+    rec->percentage = s->percentage;
+    rec->grade = s->grade;
+    memcpy(rec->name, s->name, MAX_NAME_LEN);
+    rec->name[MAX_NAME_LEN - 1] = '\0';
+    for (int i = 0; i < SUBJECT_COUNT; ++i) rec->marks[i] = s->marks[i];
+}
 
-    FILE *fp = fopen(DATA_FILE, "ab");
-    if (!fp) { printf(COL_RED "Error opening data file.\n" COL_RESET); pause_anykey(); return; }
-    fwrite(&s, sizeof(Student), 1, fp);
-    fclose(fp);
+// Decode a record written with `subjects` subjects; missing marks are 0.
+void rec_to_student(const StudentRec *rec, int subjects, Student *s) {
+    memset(s, 0, sizeof(*s));
+    s->rollNo = rec->rollNo;
+    s->total = rec->total;
+    s->percentage = rec->percentage;
+    s->grade = rec->grade;
+    memcpy(s->name, rec->name, MAX_NAME_LEN);
+    for (int i = 0; i < subjects && i < MAX_SUBJECTS; ++i) s->marks[i] = rec->marks[i];
+}
 
-    printf(COL_GREEN "Student added successfully.\n" COL_RESET);
-    pause_anykey();
+// Create DATA_FILE with just a header if it does not exist yet.
+int data_file_create() {
+    FILE *fp = io_fopen(DATA_FILE, "rb");
+    if (fp) { fclose(fp); return 1; }
+    fp = io_fopen(DATA_FILE, "wb");
+    if (!fp) return 0;
+    int ok = write_data_header(fp) && sync_file(fp);
+    ok = (fclose(fp) == 0) && ok;
+    return ok;
 }
 
-// -------- DISPLAY (sorting & pagination) --------
-int compare_by_roll(const void *a, const void *b) {
-    const Student *sa = a, *sb = b;
-    return sa->rollNo - sb->rollNo;
+// Convert a legacy file (raw Student dump) at src into the current format
+// at dst, dropping tombstones. Returns the number of records or -1.
+int migrate_legacy_file(const char *src, const char *dst) {
+    FILE *in = io_fopen(src, "rb");
+    if (!in) return -1;
+    FILE *out = io_fopen("temp.dat", "wb");
+    if (!out) { fclose(in); return -1; }
+    uint32_t buf[MAX_RECORD_SIZE / sizeof(uint32_t)];
+    StudentRec *rec = (StudentRec *)buf;
+    Student s;
+    int count = 0, ok = write_data_header(out);
+    while (ok && io_fread(&s, sizeof(Student), 1, in) == 1) {
+        if (s.grade == DELETED_GRADE) continue;
+        student_to_rec(&s, rec);
+        ok = io_fwrite(rec, RECORD_SIZE, 1, out) == 1;
+        count++;
+    }
+    fclose(in);
+    ok = sync_file(out) && ok;
+    ok = (fclose(out) == 0) && ok;
+    if (!ok) { remove("temp.dat"); return -1; }
+    if (replace_file("temp.dat", dst) != 0) { remove("temp.dat"); return -1; }
+    metric_count(MC_REWRITES, 1);
+    return count;
 }
-int compare_by_name(const void *a, const void *b) {
-    const Student *sa = a, *sb = b;
+
+// Check DATA_FILE at startup: adopt its header, or migrate a legacy file
+// in place (keeping the original as DATA_FILE LEGACY_SUFFIX).
+void data_file_open_check() {
+    set_record_layout();
+    FILE *fp = io_fopen(DATA_FILE, "rb");
+    if (!fp) return;
+    DataHeader h;
+    size_t got = io_fread(&h, 1, sizeof(h), fp);
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    if (got == sizeof(h) && header_valid(&h)) { apply_header(&h); return; }
+    if (size == 0) { remove(DATA_FILE); return; }
+    if (memcmp(h.magic, DATA_MAGIC, 4) == 0 || size % (long)sizeof(Student) != 0) {
+        printf(COL_RED "%s has an unsupported format; leaving it untouched.\n" COL_RESET, DATA_FILE);
+        pause_anykey();
+        return;
+    }
+    char legacy[256];
+    snprintf(legacy, sizeof(legacy), "%s%s", DATA_FILE, LEGACY_SUFFIX);
+    remove(legacy);
+    if (rename(DATA_FILE, legacy) != 0) return;
+    int n = migrate_legacy_file(legacy, DATA_FILE);
+    if (n < 0) {
+        rename(legacy, DATA_FILE);
+        printf(COL_RED "Migration of legacy data file failed.\n" COL_RESET);
+    } else {
+        printf(COL_YELLOW "Migrated %d records to data format v%d (old file kept as %s).\n" COL_RESET,
+               n, DATA_VERSION, legacy);
+    }
+    remove(INDEX_FILE);
+    pause_anykey();
+}
+
+// -------- LOG-STRUCTURED STORAGE (student.log) --------
+// Optional engine, selected with "log" in STORAGE_FILE. DATA_FILE is then a
+// snapshot that only checkpoints write; every add, update and delete is
+// appended to LOG_FILE as the new image of the slots it touches. Readers
+// get the snapshot with the log replayed over it, kept in memory for the
+// session (see data_view()). A writer returns once its entry is on disk:
+// a flusher thread issues one fsync for everything appended while the
+// previous fsync ran, so concurrent writers share fsyncs (group commit).
+// Once the log outgrows LOG_CHECKPOINT_BYTES, the image is written out as
+// the new snapshot and an empty log is started. Replaying an entry twice
+// is harmless, so a crash between those two steps loses nothing.
+// Processes share the log through an flock() on LOG_LOCK_FILE, held from
+// catching up with the log through choosing a slot and appending, and
+// across checkpoints; LOG_FILE is opened O_APPEND, and a torn tail is only
+// cut off under that lock.
+#define LOG_CHECKPOINT_BYTES (16L << 20)
+
+typedef struct {
+    char magic[4];          // "SLOG"
+    int32_t record_size;
+    int64_t epoch;          // lineage of snapshot + logs; new when DATA_FILE is replaced
+    int64_t base_seq;       // log bytes checkpointed before this log was started
+    int64_t snap_size;      // DATA_FILE this log applies to
+    int64_t snap_mtime;
+} LogHeader;
+
+typedef struct {
+    char magic[4];          // "SLGE"
+    int32_t slot;           // first slot written (== slot count to append)
+    int32_t count;          // records following the entry
+    uint32_t checksum;      // FNV-1a over slot, count and the records
+} LogEntry;
+
+int g_storage_log = 0;      // log engine selected in STORAGE_FILE
+
+extern unsigned g_view_generation; // see DATA VIEW
+int journal_flush();               // see IN-PLACE SLOT WRITES
+
+// Snapshot + replayed log, as one DATA_FILE image.
+struct {
+    unsigned char *base;    // DataHeader, then slots
+    size_t size, cap;
+    int64_t snap_size, snap_mtime, snap_ino;
+    LogHeader h;            // header of the log replayed (if applied > 0)
+    int64_t applied;        // bytes of LOG_FILE reflected; 0 when no usable log
+    int valid;
+} g_image;
+
+// Appending side of LOG_FILE.
+struct {
+    FILE *fp;
+    int64_t written;        // bytes handed to the OS
+    int64_t durable;        // bytes known to be on disk
+    int failed;             // an fsync failed; no further commits
+} g_logw;
+
+// Cross-process writer lock (LOG_LOCK_FILE); nests within the process.
+struct {
+    FILE *fp;
+    int depth;
+} g_log_lock;
+
+void log_lock() {
+    if (g_log_lock.depth++ > 0) return;
+    if (!g_log_lock.fp) g_log_lock.fp = io_fopen(LOG_LOCK_FILE, "ab");
+    if (g_log_lock.fp) file_lock(g_log_lock.fp);
+}
+
+void log_unlock() {
+    if (--g_log_lock.depth > 0) return;
+    if (g_log_lock.fp) file_unlock(g_log_lock.fp);
+}
+
+#ifndef _WIN32
+pthread_mutex_t g_logw_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_logw_work = PTHREAD_COND_INITIALIZER;   // bytes to sync
+pthread_cond_t g_logw_synced = PTHREAD_COND_INITIALIZER; // durable advanced
+int g_logw_flusher = 0;
+#endif
+
+void load_storage_mode() {
+    char word[16] = "";
+    FILE *fp = io_fopen(STORAGE_FILE, "r");
+    if (fp) {
+        if (fscanf(fp, "%15s", word) != 1) word[0] = '\0';
+        fclose(fp);
+    }
+    g_storage_log = strcmp(word, "log") == 0;
+}
+
+uint32_t log_entry_checksum(const LogEntry *e, const void *recs, size_t len) {
+    uint32_t h = fnv1a(2166136261u, &e->slot, sizeof(e->slot));
+    h = fnv1a(h, &e->count, sizeof(e->count));
+    return fnv1a(h, recs, len);
+}
+
+void log_image_free() {
+    free(g_image.base);
+    memset(&g_image, 0, sizeof(g_image));
+    g_view_generation++;
+}
+
+int log_image_rec_size() {
+    const DataHeader *h = (const DataHeader *)g_image.base;
+    return h && g_image.size >= DATA_HEADER_SIZE && header_valid(h) ? (int)h->record_size : 0;
+}
+
+// Write count records at slot of the image (slot may be one past the end).
+int log_image_apply(int slot, int count, const void *recs) {
+    int rec_size = log_image_rec_size();
+    if (!rec_size || slot < 0 || count <= 0) return 0;
+    size_t slots = (g_image.size - DATA_HEADER_SIZE) / rec_size;
+    if ((size_t)slot > slots) return 0;
+    size_t need = DATA_HEADER_SIZE + ((size_t)slot + count) * rec_size;
+    if (need > g_image.cap) {
+        size_t cap = g_image.cap * 2;
+        if (cap < need) cap = need;
+        unsigned char *grown = realloc(g_image.base, cap);
+        if (!grown) return 0;
+        g_image.base = grown;
+        g_image.cap = cap;
+    }
+    memcpy(g_image.base + DATA_HEADER_SIZE + (size_t)slot * rec_size, recs, (size_t)count * rec_size);
+    if (need > g_image.size) g_image.size = need;
+    g_view_generation++;
+    return 1;
+}
+
+// Replay the entries of LOG_FILE the image has not seen. A log written for
+// another snapshot is ignored; a torn or corrupt entry ends the replay.
+// Returns 0 if the image must be reloaded from scratch.
+int log_image_catch_up() {
+    FILE *lp = io_fopen(LOG_FILE, "rb");
+    if (!lp) return g_image.applied == 0;
+    LogHeader h;
+    int rec_size = log_image_rec_size();
+    int usable = io_fread(&h, sizeof(h), 1, lp) == 1 && memcmp(h.magic, "SLOG", 4) == 0 &&
+                 h.record_size == rec_size && h.snap_size == g_image.snap_size &&
+                 h.snap_mtime == g_image.snap_mtime;
+    if (!usable) { fclose(lp); return g_image.applied == 0; }
+    if (g_image.applied == 0) {
+        g_image.h = h;
+        g_image.applied = sizeof(h);
+    } else if (h.epoch != g_image.h.epoch || h.base_seq != g_image.h.base_seq) {
+        fclose(lp);
+        return 0;
+    }
+    fseek(lp, 0, SEEK_END);
+    int64_t end = (int64_t)ftell(lp);
+    fseek(lp, (long)g_image.applied, SEEK_SET);
+    LogEntry e;
+    while (io_fread(&e, sizeof(e), 1, lp) == 1) {
+        if (memcmp(e.magic, "SLGE", 4) != 0 || e.count <= 0 ||
+            (int64_t)e.count > (end - g_image.applied) / rec_size) break;
+        size_t len = (size_t)e.count * rec_size;
+        void *recs = malloc(len);
+        int ok = recs && io_fread(recs, 1, len, lp) == len && log_entry_checksum(&e, recs, len) == e.checksum &&
+                 log_image_apply(e.slot, e.count, recs);
+        free(recs);
+        if (!ok) break;
+        g_image.applied += (int64_t)(sizeof(e) + len);
+    }
+    fclose(lp);
+    return 1;
+}
+
+// Read the snapshot into a fresh image and replay the log over it.
+int log_image_load() {
+    log_image_free();
+    struct stat st;
+    if (stat(DATA_FILE, &st) != 0) return 0;
+    FILE *fp = io_fopen(DATA_FILE, "rb");
+    if (!fp) return 0;
+    g_image.cap = (size_t)st.st_size + 1;
+    g_image.base = malloc(g_image.cap);
+    g_image.size = g_image.base ? io_fread(g_image.base, 1, (size_t)st.st_size, fp) : 0;
+    fclose(fp);
+    if (!g_image.base || g_image.size != (size_t)st.st_size) { log_image_free(); return 0; }
+    g_image.snap_size = (int64_t)st.st_size;
+    g_image.snap_mtime = (int64_t)st.st_mtime;
+    g_image.snap_ino = (int64_t)st.st_ino;
+    g_image.valid = 1;
+    if (!log_image_catch_up()) { log_image_free(); return 0; }
+    return 1;
+}
+
+// Bring the image up to date with the snapshot and the log. Returns 0 if
+// there is no data file.
+int log_image_sync() {
+    struct stat st, lt;
+    if (stat(DATA_FILE, &st) != 0) { if (g_image.valid) log_image_free(); return 0; }
+    int have_log = stat(LOG_FILE, &lt) == 0;
+    int same_snapshot = g_image.valid && (int64_t)st.st_size == g_image.snap_size &&
+                        (int64_t)st.st_mtime == g_image.snap_mtime && (int64_t)st.st_ino == g_image.snap_ino;
+    int64_t log_size = have_log ? (int64_t)lt.st_size : 0;
+    if (!same_snapshot || log_size < g_image.applied) return log_image_load();
+    if (log_size > g_image.applied && !log_image_catch_up()) return log_image_load();
+    return 1;
+}
+
+// Stamp of the data in log mode: bytes ever logged and the lineage. It
+// changes with every append but not at checkpoints, so the sidecar indexes
+// survive them. Returns 0 when there is no usable log (use the file stamp).
+int log_stamp(int64_t *size, int64_t *mtime) {
+    FILE *lp = io_fopen(LOG_FILE, "rb");
+    if (!lp) return 0;
+    LogHeader h;
+    int ok = io_fread(&h, sizeof(h), 1, lp) == 1 && memcmp(h.magic, "SLOG", 4) == 0;
+    fseek(lp, 0, SEEK_END);
+    long end = ftell(lp);
+    fclose(lp);
+    if (!ok) return 0;
+    *size = h.base_seq + (int64_t)end - (int64_t)sizeof(h);
+    *mtime = h.epoch;
+    return 1;
+}
+
+#ifndef _WIN32
+// fsync LOG_FILE for every batch of appends that piled up meanwhile.
+void *log_flusher(void *unused) {
+    (void)unused;
+    pthread_mutex_lock(&g_logw_lock);
+    while (1) {
+        while (!g_logw.fp || g_logw.written == g_logw.durable || g_logw.failed)
+            pthread_cond_wait(&g_logw_work, &g_logw_lock);
+        int64_t target = g_logw.written;
+        int fd = fileno(g_logw.fp);
+        pthread_mutex_unlock(&g_logw_lock);
+        int ok = fsync(fd) == 0;
+        pthread_mutex_lock(&g_logw_lock);
+        if (ok) g_logw.durable = target; else g_logw.failed = 1;
+        pthread_cond_broadcast(&g_logw_synced);
+    }
+    return NULL;
+}
+#endif
+
+// Wait until the log is durable up to byte lsn. Returns 0 on I/O error.
+int log_sync_to(int64_t lsn) {
+#ifdef _WIN32
+    if (g_logw.durable < lsn) {
+        if (!sync_file(g_logw.fp)) return 0;
+        g_logw.durable = g_logw.written;
+    }
+    return 1;
+#else
+    pthread_mutex_lock(&g_logw_lock);
+    if (!g_logw_flusher) {
+        pthread_t t;
+        if (pthread_create(&t, NULL, log_flusher, NULL) == 0) { pthread_detach(t); g_logw_flusher = 1; }
+    }
+    if (g_logw_flusher) {
+        pthread_cond_signal(&g_logw_work);
+        while (g_logw.fp && g_logw.durable < lsn && !g_logw.failed)
+            pthread_cond_wait(&g_logw_synced, &g_logw_lock);
+    } else if (g_logw.fp && g_logw.durable < lsn && fsync(fileno(g_logw.fp)) == 0) {
+        g_logw.durable = g_logw.written;
+    }
+    int ok = g_logw.durable >= lsn;
+    pthread_mutex_unlock(&g_logw_lock);
+    return ok;
+#endif
+}
+
+void log_close_writer() {
+    if (!g_logw.fp) return;
+    log_sync_to(g_logw.written);
+#ifndef _WIN32
+    pthread_mutex_lock(&g_logw_lock);
+#endif
+    fclose(g_logw.fp);
+    memset(&g_logw, 0, sizeof(g_logw));
+#ifndef _WIN32
+    pthread_mutex_unlock(&g_logw_lock);
+#endif
+}
+
+// Start an empty LOG_FILE over the current snapshot.
+int log_create(int64_t epoch, int64_t base_seq) {
+    LogHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "SLOG", 4);
+    h.record_size = log_image_rec_size();
+    h.epoch = epoch;
+    h.base_seq = base_seq;
+    h.snap_size = g_image.snap_size;
+    h.snap_mtime = g_image.snap_mtime;
+    FILE *fp = io_fopen("temp.log", "wb");
+    if (!fp) return 0;
+    int ok = io_fwrite(&h, sizeof(h), 1, fp) == 1 && sync_file(fp);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || replace_file("temp.log", LOG_FILE) != 0) { remove("temp.log"); return 0; }
+    g_image.h = h;
+    g_image.applied = sizeof(h);
+    return 1;
+}
+
+// A new lineage id. Negative, so it never equals a file mtime.
+int64_t log_new_epoch(int64_t previous) {
+    int64_t e = -(int64_t)time(NULL) * 1024;
+    return e < previous ? e : previous - 1;
+}
+
+// Catch up with LOG_FILE and get it ready for an append at its end:
+// (re)opened if another process started a new one, created if there is
+// none, and cut back to the last whole entry. Called under log_lock(),
+// so no other writer can be in the middle of an entry.
+int log_open_writer() {
+    if (!data_file_create() || !log_image_sync()) return 0;
+    struct stat held, now;
+    if (g_logw.fp && (g_image.applied == 0 || fstat(fileno(g_logw.fp), &held) != 0 ||
+                      stat(LOG_FILE, &now) != 0 || held.st_ino != now.st_ino))
+        log_close_writer();
+    if (!g_logw.fp) {
+        if (g_image.applied == 0 && !log_create(log_new_epoch(0), 0)) return 0;
+        FILE *fp = io_fopen(LOG_FILE, "ab");
+        if (!fp) return 0;
+        g_logw.fp = fp;
+        g_logw.written = g_logw.durable = g_image.applied;
+        g_logw.failed = 0;
+    }
+    if (fstat(fileno(g_logw.fp), &held) != 0) return 0;
+    if ((int64_t)held.st_size != g_image.applied) { // torn tail a crashed writer left
+#ifdef _WIN32
+        if (_chsize_s(_fileno(g_logw.fp), g_image.applied) != 0) return 0;
+#else
+        if (ftruncate(fileno(g_logw.fp), (off_t)g_image.applied) != 0) return 0;
+#endif
+    }
+    return 1;
+}
+
+// DATA_FILE was replaced as a whole: the log no longer applies to it.
+void log_reset() {
+    if (g_storage_log) log_lock(); // file engine: no log writers to keep out
+    log_close_writer();
+    remove(LOG_FILE);
+    if (g_image.valid) log_image_free();
+    if (g_storage_log) log_unlock();
+}
+
+int log_checkpoint_locked();
+
+// Write the image out as the new snapshot and start an empty log.
+int log_checkpoint() {
+    if (!g_storage_log) return 1;
+    log_lock();
+    int ok = log_checkpoint_locked();
+    log_unlock();
+    return ok;
+}
+
+int log_checkpoint_locked() {
+    if (!log_image_sync() || g_image.applied <= (int64_t)sizeof(LogHeader)) return 1;
+    MetricScope m;
+    metric_begin(&m, MOP_CHECKPOINT);
+    log_close_writer();
+    FILE *fp = io_fopen("temp.dat", "wb");
+    if (!fp) return metric_end(&m, 0);
+    int ok = io_fwrite(g_image.base, 1, g_image.size, fp) == g_image.size && sync_file(fp);
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok) { remove("temp.dat"); return metric_end(&m, 0); }
+    if (replace_file("temp.dat", DATA_FILE) != 0) { remove("temp.dat"); return metric_end(&m, 0); }
+    metric_count(MC_REWRITES, 1);
+    struct stat st;
+    if (stat(DATA_FILE, &st) != 0) return metric_end(&m, 0);
+    g_image.snap_size = (int64_t)st.st_size;
+    g_image.snap_mtime = (int64_t)st.st_mtime;
+    g_image.snap_ino = (int64_t)st.st_ino;
+    return metric_end(&m, log_create(g_image.h.epoch, g_image.h.base_seq + g_image.applied - (int64_t)sizeof(LogHeader)));
+}
+
+// Append count encoded records at slot and apply them to the image.
+// Returns once the entry is durable; 0 on error.
+int log_write(int slot, const void *recs, int count) {
+    log_lock();
+    if (!log_open_writer()) { log_unlock(); return 0; }
+    LogEntry e;
+    memcpy(e.magic, "SLGE", 4);
+    e.slot = slot;
+    e.count = count;
+    size_t len = (size_t)count * RECORD_SIZE;
+    e.checksum = log_entry_checksum(&e, recs, len);
+#ifndef _WIN32
+    pthread_mutex_lock(&g_logw_lock);
+#endif
+    g_logw.written = g_image.applied; // other processes may have appended
+    int ok = io_fwrite(&e, sizeof(e), 1, g_logw.fp) == 1 && io_fwrite(recs, 1, len, g_logw.fp) == len &&
+             fflush(g_logw.fp) == 0;
+    int64_t lsn = g_logw.written += (int64_t)(sizeof(e) + len);
+#ifndef _WIN32
+    pthread_mutex_unlock(&g_logw_lock);
+#endif
+    if (!ok) { log_close_writer(); log_unlock(); return 0; }
+    ok = log_image_apply(slot, count, recs);
+    g_image.applied = lsn;
+    log_unlock();
+    ok = log_sync_to(lsn) && ok;
+    if (ok && lsn - (int64_t)sizeof(LogHeader) > LOG_CHECKPOINT_BYTES) log_checkpoint();
+    return ok;
+}
+
+// Fold a log left behind by the log engine into DATA_FILE when the plain
+// file engine is selected. Called once at startup.
+void log_recover() {
+    struct stat lt;
+    if (g_storage_log || stat(LOG_FILE, &lt) != 0) return;
+    g_storage_log = 1;
+    int ok = log_checkpoint();
+    log_close_writer();
+    g_storage_log = 0;
+    if (ok) remove(LOG_FILE);
+    if (g_image.valid) log_image_free();
+}
+
+// Switch storage engines (persisted in STORAGE_FILE). Leaving the log
+// engine checkpoints first, so DATA_FILE holds everything.
+int storage_set_mode(int use_log) {
+    if (use_log == g_storage_log) return 1;
+    if (use_log && !journal_flush()) return 0; // the log takes over from here
+    if (!use_log) {
+        if (!log_checkpoint()) return 0;
+        log_reset();
+    }
+    FILE *fp = io_fopen(STORAGE_FILE, "w");
+    if (!fp) return 0;
+    fprintf(fp, "%s\n", use_log ? "log" : "file");
+    if (fclose(fp) != 0) return 0;
+    g_storage_log = use_log;
+    if (g_image.valid) log_image_free();
+    return 1;
+}
+
+// -------- DATA VIEW (memory-mapped DATA_FILE) --------
+// Readers get read-only access to every slot (tombstones included) mapped
+// straight over DATA_FILE. The mapping lives for the whole session and
+// reserves address space past the end of the file, so our own updates and
+// appends show through it without remapping (data_view_written() records
+// the new file identity). It is only redone when the file's size, mtime
+// or inode changes behind our back, i.e. another process wrote it.
+typedef struct {
+    const unsigned char *recs;  // first slot
+    int slots;
+    int rec_size;               // layout of the mapped file
+    int subjects;
+} StudentView;
+
+const StudentRec *view_rec(const StudentView *v, int slot) {
+    return (const StudentRec *)(v->recs + (size_t)slot * (size_t)v->rec_size);
+}
+
+#define MAP_SLACK (1L << 20)  // address space mapped past EOF for appends
+
+struct {
+    void *base;
+    size_t size;
+    size_t mapped;      // bytes of address space (Windows: of the copy)
+    int64_t mtime;
+    int64_t mtime_ns;
+    int64_t ino;
+    int valid;
+} g_map;
+
+unsigned g_view_generation = 0; // bumped whenever the data behind the view changes
+int g_view_pinned = 0;          // serve the current view without checking DATA_FILE
+
+int64_t stat_mtime_ns(const struct stat *st) {
+#ifdef __linux__
+    return (int64_t)st->st_mtim.tv_nsec;
+#else
+    (void)st;
+    return 0;
+#endif
+}
+
+void data_view_release() {
+    if (g_map.base) {
+#ifdef _WIN32
+        free(g_map.base);
+#else
+        munmap(g_map.base, g_map.mapped);
+#endif
+    }
+    memset(&g_map, 0, sizeof(g_map));
+    g_view_generation++;
+}
+
+// Called before DATA_FILE is replaced or rewritten wholesale: settles
+// pending slot writes and drops the mapping.
+void data_view_invalidate() {
+    journal_flush();
+    data_view_release();
+    if (g_image.valid) log_image_free();
+}
+
+// We wrote len bytes at offset through fp: keep the view (and everything
+// cached from it) instead of remapping, when the mapping can cover it.
+void data_view_written(FILE *fp, long offset, const void *data, size_t len) {
+    struct stat st;
+    g_view_generation++;
+    if (!g_map.valid || fstat(fileno(fp), &st) != 0 || (int64_t)st.st_ino != g_map.ino ||
+        (size_t)st.st_size > g_map.mapped || (size_t)st.st_size < g_map.size) {
+        data_view_release();
+        return;
+    }
+#ifdef _WIN32
+    memcpy((char *)g_map.base + offset, data, len); // the view is a private copy
+#else
+    (void)offset; (void)data; (void)len;             // MAP_SHARED sees the page cache
+#endif
+    g_map.size = (size_t)st.st_size;
+    g_map.mtime = (int64_t)st.st_mtime;
+    g_map.mtime_ns = stat_mtime_ns(&st);
+}
+
+int data_view_map(const struct stat *st) {
+    size_t size = (size_t)st->st_size;
+    size_t mapped = size + size / 2 + MAP_SLACK;
+    if (size > 0) {
 #ifdef _WIN32
-    return _stricmp(sa->name, sb->name);
+        FILE *fp = io_fopen(DATA_FILE, "rb");
+        if (!fp) return 0;
+        g_map.base = malloc(mapped);
+        if (!g_map.base || io_fread(g_map.base, 1, size, fp) != size) {
+            fclose(fp);
+            data_view_release();
+            return 0;
+        }
+        fclose(fp);
+#else
+        int fd = open(DATA_FILE, O_RDONLY);
+        if (fd < 0) return 0;
+        void *base = mmap(NULL, mapped, PROT_READ, MAP_SHARED, fd, 0); // pages past EOF stay untouched
+        close(fd);
+        if (base == MAP_FAILED) return 0;
+        g_map.base = base;
+        metric_count(MC_BYTES_READ, size); // paged in on demand; counted as read once per mapping
+#endif
+    }
+    g_map.size = size;
+    g_map.mapped = size > 0 ? mapped : 0;
+    g_map.mtime = (int64_t)st->st_mtime;
+    g_map.mtime_ns = stat_mtime_ns(st);
+    g_map.ino = (int64_t)st->st_ino;
+    g_map.valid = 1;
+    return 1;
+}
+
+// Fill *v with the current contents of DATA_FILE (with the log engine: of
+// the in-memory image). Returns 0 if there is no data file. Pointers stay
+// valid until the next write, or the next data_view() call that sees
+// DATA_FILE changed. While g_view_pinned is set, an existing view is
+// served as it is and never replaced.
+int data_view(StudentView *v) {
+    v->recs = NULL;
+    v->slots = 0;
+    v->rec_size = RECORD_SIZE;
+    v->subjects = SUBJECT_COUNT;
+    const void *base;
+    size_t size;
+    if (g_storage_log) {
+        if (!(g_view_pinned && g_image.valid) && !log_image_sync()) return 0;
+        base = g_image.base;
+        size = g_image.size;
+    } else {
+        struct stat st;
+        if (!(g_view_pinned && g_map.valid)) {
+            if (stat(DATA_FILE, &st) != 0) { data_view_release(); return 0; }
+            if (!(g_map.valid && (size_t)st.st_size == g_map.size && (int64_t)st.st_mtime == g_map.mtime &&
+                  stat_mtime_ns(&st) == g_map.mtime_ns && (int64_t)st.st_ino == g_map.ino)) {
+                data_view_release();
+                if (!data_view_map(&st)) return 0;
+            }
+        }
+        base = g_map.base;
+        size = g_map.size;
+    }
+    const DataHeader *h = base;
+    if (!h || size < DATA_HEADER_SIZE || !header_valid(h)) return 0;
+    if ((int)h->subject_count != SUBJECT_COUNT || (int)h->record_size != RECORD_SIZE) apply_header(h);
+    v->recs = (const unsigned char *)base + DATA_HEADER_SIZE;
+    v->rec_size = (int)h->record_size;
+    v->subjects = (int)h->subject_count;
+    v->slots = (int)((size - DATA_HEADER_SIZE) / h->record_size);
+    return 1;
+}
+
+// -------- ROLL INDEX (student.idx) --------
+// Open-addressing hash table on disk: rollNo -> record slot in DATA_FILE.
+// The header remembers the stamp (size, mtime, inode) of DATA_FILE at the
+// last sync, so an index that is missing or older than the data file is
+// rebuilt on open.
+#define IDX_EMPTY   -1
+#define IDX_DELETED -2
+#define IDX_MIN_CAPACITY 64
+
+// What a sidecar was last synced against: size, mtime (seconds and
+// nanoseconds) and inode of DATA_FILE. In log mode, the log stamp with
+// mtime_ns and ino left 0.
+typedef struct {
+    int64_t size;
+    int64_t mtime;
+    int64_t mtime_ns;
+    int64_t ino;
+} DataStamp;
+
+typedef struct {
+    char magic[4];      // "SIDX"
+    int32_t capacity;   // bucket count, power of two
+    int32_t used;       // live keys
+    int32_t deleted;    // IDX_DELETED buckets
+    int32_t tombstones; // deleted record slots in DATA_FILE
+    DataStamp data;     // DATA_FILE stamp at last sync
+} IndexHeader;
+
+typedef struct {
+    int32_t rollNo;
+    int32_t slot;       // record slot, IDX_EMPTY or IDX_DELETED
+} IndexBucket;
+
+// Stamp of path as stat() sees it (all zero if it does not exist).
+void file_stamp(const char *path, DataStamp *d) {
+    memset(d, 0, sizeof(*d));
+    struct stat st;
+    if (stat(path, &st) != 0) return;
+    d->size = (int64_t)st.st_size;
+    d->mtime = (int64_t)st.st_mtime;
+    d->mtime_ns = stat_mtime_ns(&st);
+    d->ino = (int64_t)st.st_ino;
+}
+
+void data_file_stamp(DataStamp *d) {
+    memset(d, 0, sizeof(*d));
+    if (g_storage_log && log_stamp(&d->size, &d->mtime)) return;
+    file_stamp(DATA_FILE, d);
+}
+
+DataStamp data_stamp() {
+    DataStamp d;
+    data_file_stamp(&d);
+    return d;
+}
+
+int stamp_equal(DataStamp a, DataStamp b) {
+    return a.size == b.size && a.mtime == b.mtime && a.mtime_ns == b.mtime_ns && a.ino == b.ino;
+}
+
+unsigned idx_hash(int roll, int capacity) {
+    uint32_t h = (uint32_t)roll * 2654435761u;
+    h ^= h >> 16;
+    return h & (uint32_t)(capacity - 1);
+}
+
+long idx_bucket_offset(unsigned i) {
+    return (long)sizeof(IndexHeader) + (long)i * (long)sizeof(IndexBucket);
+}
+
+// Rebuild the whole index from DATA_FILE with at least min_capacity buckets.
+int index_rebuild(int min_capacity) {
+    int capacity = IDX_MIN_CAPACITY;
+    StudentView v;
+    data_view(&v);
+    while (capacity < min_capacity || capacity < (long)v.slots * 2) capacity *= 2;
+
+    IndexBucket *table = malloc(sizeof(IndexBucket) * capacity);
+    if (!table) return 0;
+    for (int i = 0; i < capacity; ++i) { table[i].rollNo = 0; table[i].slot = IDX_EMPTY; }
+
+    IndexHeader h;
+    memcpy(h.magic, "SIDX", 4);
+    h.capacity = capacity;
+    h.used = 0;
+    h.deleted = 0;
+    h.tombstones = 0;
+    metric_count(MC_SCANNED, (uint64_t)v.slots);
+    for (int slot = 0; slot < v.slots; ++slot) {
+        const StudentRec *r = view_rec(&v, slot);
+        if (is_deleted(r)) { h.tombstones++; continue; }
+        unsigned i = idx_hash(r->rollNo, capacity);
+        while (table[i].slot != IDX_EMPTY && table[i].rollNo != r->rollNo)
+            i = (i + 1) & (capacity - 1);
+        if (table[i].slot != IDX_EMPTY) continue; // keep first occurrence
+        table[i].rollNo = r->rollNo;
+        table[i].slot = slot;
+        h.used++;
+    }
+    data_file_stamp(&h.data);
+
+    char temp[256];
+    temp_path(INDEX_FILE, temp, sizeof(temp));
+    FILE *ip = io_fopen(temp, "wb");
+    if (!ip) { free(table); return 0; }
+    int ok = io_fwrite(&h, sizeof(h), 1, ip) == 1 &&
+             io_fwrite(table, sizeof(IndexBucket), capacity, ip) == (size_t)capacity;
+    ok = (fclose(ip) == 0) && ok;
+    free(table);
+    ok = ok && replace_file(temp, INDEX_FILE) == 0;
+    if (!ok) remove(temp);
+    return ok;
+}
+
+// Open the index for reading/writing. With validate set, a missing, corrupt
+// or stale index is rebuilt first. Mutating callers validate before they
+// touch DATA_FILE and then reopen without validation to record the change.
+FILE *index_open(IndexHeader *h, int validate) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        FILE *ip = io_fopen(INDEX_FILE, "r+b");
+        if (ip) {
+            if (io_fread(h, sizeof(*h), 1, ip) == 1 && memcmp(h->magic, "SIDX", 4) == 0 &&
+                h->capacity >= IDX_MIN_CAPACITY && (h->capacity & (h->capacity - 1)) == 0) {
+                if (!validate) return ip;
+                if (stamp_equal(data_stamp(), h->data)) return ip;
+            }
+            fclose(ip);
+        }
+        if (!index_rebuild(IDX_MIN_CAPACITY)) return NULL;
+    }
+    return NULL;
+}
+
+// Probe for roll. Returns the bucket position holding it, or -1 and the
+// first reusable bucket in *free_pos.
+long index_probe(FILE *ip, const IndexHeader *h, int roll, long *free_pos) {
+    unsigned i = idx_hash(roll, h->capacity);
+    if (free_pos) *free_pos = -1;
+    for (int n = 0; n < h->capacity; ++n) {
+        IndexBucket b;
+        fseek(ip, idx_bucket_offset(i), SEEK_SET);
+        if (io_fread(&b, sizeof(b), 1, ip) != 1) return -1;
+        if (b.slot == IDX_EMPTY) {
+            if (free_pos && *free_pos < 0) *free_pos = i;
+            return -1;
+        }
+        if (b.slot == IDX_DELETED) {
+            if (free_pos && *free_pos < 0) *free_pos = i;
+        } else if (b.rollNo == roll) {
+            return i;
+        }
+        i = (i + 1) & (h->capacity - 1);
+    }
+    return -1;
+}
+
+void index_write_header(FILE *ip, IndexHeader *h) {
+    data_file_stamp(&h->data);
+    fseek(ip, 0, SEEK_SET);
+    io_fwrite(h, sizeof(*h), 1, ip);
+}
+
+// Slot of roll in DATA_FILE, or -1 if absent.
+int index_lookup(int roll) {
+    IndexHeader h;
+    FILE *ip = index_open(&h, 1);
+    if (!ip) return -1;
+    int slot = -1;
+    long pos = index_probe(ip, &h, roll, NULL);
+    if (pos >= 0) {
+        IndexBucket b;
+        fseek(ip, idx_bucket_offset(pos), SEEK_SET);
+        if (io_fread(&b, sizeof(b), 1, ip) == 1) slot = b.slot;
+    }
+    fclose(ip);
+    return slot;
+}
+
+// Record that roll now lives at slot (DATA_FILE already written).
+void index_insert(int roll, int slot) {
+    IndexHeader h;
+    FILE *ip = index_open(&h, 0);
+    if (!ip) return;
+    if ((h.used + h.deleted + 1) * 2 > h.capacity) {
+        fclose(ip);
+        index_rebuild(h.capacity * 2);
+        return;
+    }
+    long free_pos;
+    long pos = index_probe(ip, &h, roll, &free_pos);
+    IndexBucket b = { roll, slot };
+    if (pos < 0) {
+        pos = free_pos;
+        if (pos < 0) { fclose(ip); index_rebuild(h.capacity * 2); return; }
+        fseek(ip, idx_bucket_offset(pos), SEEK_SET);
+        IndexBucket old;
+        if (io_fread(&old, sizeof(old), 1, ip) == 1 && old.slot == IDX_DELETED) h.deleted--;
+        h.used++;
+    }
+    fseek(ip, idx_bucket_offset(pos), SEEK_SET);
+    io_fwrite(&b, sizeof(b), 1, ip);
+    index_write_header(ip, &h);
+    fclose(ip);
+}
+
+// Drop roll from the index after its slot was tombstoned.
+void index_remove(int roll) {
+    IndexHeader h;
+    FILE *ip = index_open(&h, 0);
+    if (!ip) return;
+    long pos = index_probe(ip, &h, roll, NULL);
+    if (pos >= 0) {
+        IndexBucket b = { roll, IDX_DELETED };
+        fseek(ip, idx_bucket_offset(pos), SEEK_SET);
+        io_fwrite(&b, sizeof(b), 1, ip);
+        h.used--;
+        h.deleted++;
+        h.tombstones++;
+    }
+    index_write_header(ip, &h);
+    fclose(ip);
+}
+
+// Live records and tombstoned slots according to a fresh index.
+int index_counts(int *live, int *tombstones) {
+    IndexHeader h;
+    FILE *ip = index_open(&h, 1);
+    if (!ip) return 0;
+    fclose(ip);
+    *live = h.used;
+    *tombstones = h.tombstones;
+    return 1;
+}
+
+// DATA_FILE changed without moving any slot; re-stamp the index.
+void index_touch() {
+    IndexHeader h;
+    FILE *ip = index_open(&h, 0);
+    if (!ip) return;
+    index_write_header(ip, &h);
+    fclose(ip);
+}
+
+// -------- NAME TRIGRAM INDEX (student.tri) --------
+// Inverted index from lowercased name trigrams to record slots, used for
+// case-insensitive substring search. The file holds a sorted section
+// (directory of trigrams + slot postings, written by tri_rebuild) followed
+// by an append-only tail of (trigram, slot) pairs added since. Postings are
+// never removed: every candidate is verified against the record, so stale
+// entries left by renames and deletes are harmless until the next rebuild.
+#define TRI_MAX_DELTA 8192
+
+typedef struct {
+    char magic[4];      // "STRI"
+    int32_t ntri;       // directory entries
+    int32_t npost;      // postings in the sorted section
+    int32_t ndelta;     // pairs appended since the last rebuild
+    DataStamp data;     // DATA_FILE stamp at last sync
+} TriHeader;
+
+typedef struct {
+    uint32_t tri;
+    uint32_t start;     // first posting
+    uint32_t count;
+} TriDirEntry;
+
+typedef struct {
+    uint32_t tri;
+    int32_t slot;
+} TriDelta;
+
+// Distinct trigrams of the lowercased text. Returns how many were stored.
+int name_trigrams(const char *text, uint32_t *out, int max) {
+    int n = 0;
+    size_t len = strlen(text);
+    for (size_t i = 0; i + 3 <= len; ++i) {
+        uint32_t t = ((uint32_t)(unsigned char)tolower((unsigned char)text[i]) << 16) |
+                     ((uint32_t)(unsigned char)tolower((unsigned char)text[i + 1]) << 8) |
+                     (uint32_t)(unsigned char)tolower((unsigned char)text[i + 2]);
+        int dup = 0;
+        for (int k = 0; k < n && !dup; ++k) dup = out[k] == t;
+        if (!dup && n < max) out[n++] = t;
+    }
+    return n;
+}
+
+int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+long tri_postings_offset(const TriHeader *h) {
+    return (long)sizeof(TriHeader) + (long)h->ntri * (long)sizeof(TriDirEntry);
+}
+
+long tri_delta_offset(const TriHeader *h) {
+    return tri_postings_offset(h) + (long)h->npost * (long)sizeof(int32_t);
+}
+
+int tri_rebuild() {
+    StudentView v;
+    int have = data_view(&v);
+    size_t n = 0, cap = 1024;
+    uint64_t *pairs = malloc(sizeof(uint64_t) * cap);
+    if (!pairs) return 0;
+    if (have) metric_count(MC_SCANNED, (uint64_t)v.slots);
+    for (int slot = 0; have && slot < v.slots; ++slot) {
+        const StudentRec *r = view_rec(&v, slot);
+        if (is_deleted(r)) continue;
+        uint32_t tris[MAX_NAME_LEN];
+        int k = name_trigrams(r->name, tris, MAX_NAME_LEN);
+        if (n + k > cap) {
+            while (n + k > cap) cap *= 2;
+            uint64_t *grown = realloc(pairs, sizeof(uint64_t) * cap);
+            if (!grown) { free(pairs); return 0; }
+            pairs = grown;
+        }
+        for (int i = 0; i < k; ++i) pairs[n++] = ((uint64_t)tris[i] << 32) | (uint32_t)slot;
+    }
+    qsort(pairs, n, sizeof(uint64_t), compare_u64);
+
+    TriHeader h;
+    memcpy(h.magic, "STRI", 4);
+    h.ntri = 0;
+    h.npost = (int32_t)n;
+    h.ndelta = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (i == 0 || (pairs[i] >> 32) != (pairs[i - 1] >> 32)) h.ntri++;
+    data_file_stamp(&h.data);
+
+    char temp[256];
+    temp_path(TRIGRAM_FILE, temp, sizeof(temp));
+    FILE *fp = io_fopen(temp, "wb");
+    if (!fp) { free(pairs); return 0; }
+    int ok = io_fwrite(&h, sizeof(h), 1, fp) == 1;
+    for (size_t i = 0; ok && i < n; ) {
+        TriDirEntry e = { (uint32_t)(pairs[i] >> 32), (uint32_t)i, 0 };
+        while (i < n && (pairs[i] >> 32) == e.tri) { e.count++; i++; }
+        ok = io_fwrite(&e, sizeof(e), 1, fp) == 1;
+    }
+    for (size_t i = 0; ok && i < n; ++i) {
+        int32_t slot = (int32_t)(uint32_t)pairs[i];
+        ok = io_fwrite(&slot, sizeof(slot), 1, fp) == 1;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    free(pairs);
+    ok = ok && replace_file(temp, TRIGRAM_FILE) == 0;
+    if (!ok) remove(temp);
+    return ok;
+}
+
+// Open the trigram index, rebuilding it first when missing or stale (if
+// validate is set). Returns NULL if it cannot be built.
+FILE *tri_open(TriHeader *h, int validate) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        FILE *fp = io_fopen(TRIGRAM_FILE, "r+b");
+        if (fp) {
+            if (io_fread(h, sizeof(*h), 1, fp) == 1 && memcmp(h->magic, "STRI", 4) == 0) {
+                if (!validate) return fp;
+                if (stamp_equal(data_stamp(), h->data)) return fp;
+            }
+            fclose(fp);
+        }
+        if (!validate || !tri_rebuild()) return NULL;
+    }
+    return NULL;
+}
+
+// Index the name of a record written at slot (name NULL: nothing to add,
+// just re-stamp). Only applied when the index was in sync with DATA_FILE
+// as of `before`; otherwise it stays stale and is rebuilt on next search.
+void tri_add(int slot, const char *name, DataStamp before) {
+    TriHeader h;
+    FILE *fp = tri_open(&h, 0);
+    if (!fp) return;
+    if (!stamp_equal(h.data, before)) { fclose(fp); return; }
+    uint32_t tris[MAX_NAME_LEN];
+    int k = name ? name_trigrams(name, tris, MAX_NAME_LEN) : 0;
+    if (h.ndelta + k > TRI_MAX_DELTA) {
+        fclose(fp);
+        remove(TRIGRAM_FILE); // rebuilt lazily with the tail merged in
+        return;
+    }
+    fseek(fp, tri_delta_offset(&h) + (long)h.ndelta * (long)sizeof(TriDelta), SEEK_SET);
+    for (int i = 0; i < k; ++i) {
+        TriDelta d = { tris[i], slot };
+        io_fwrite(&d, sizeof(d), 1, fp);
+    }
+    h.ndelta += k;
+    data_file_stamp(&h.data);
+    fseek(fp, 0, SEEK_SET);
+    io_fwrite(&h, sizeof(h), 1, fp);
+    fclose(fp);
+}
+
+// Sorted slots posted under trigram t (sorted section plus tail).
+int32_t *tri_postings(FILE *fp, const TriHeader *h, const TriDelta *delta, uint32_t t, int *count) {
+    *count = 0;
+    TriDirEntry e = { t, 0, 0 };
+    int lo = 0, hi = h->ntri - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        TriDirEntry m;
+        fseek(fp, (long)sizeof(TriHeader) + (long)mid * (long)sizeof(TriDirEntry), SEEK_SET);
+        if (io_fread(&m, sizeof(m), 1, fp) != 1) break;
+        if (m.tri == t) { e = m; break; }
+        if (m.tri < t) lo = mid + 1; else hi = mid - 1;
+    }
+    int extra = 0;
+    for (int i = 0; i < h->ndelta; ++i) extra += delta[i].tri == t;
+    int32_t *list = malloc(sizeof(int32_t) * (e.count + extra + 1));
+    if (!list) return NULL;
+    if (e.count > 0) {
+        fseek(fp, tri_postings_offset(h) + (long)e.start * (long)sizeof(int32_t), SEEK_SET);
+        if (io_fread(list, sizeof(int32_t), e.count, fp) != e.count) { free(list); return NULL; }
+    }
+    int n = (int)e.count;
+    if (extra > 0) {
+        for (int i = 0; i < h->ndelta; ++i)
+            if (delta[i].tri == t) list[n++] = delta[i].slot;
+        // tail slots are mostly new appends; a short insertion pass keeps order
+        for (int i = (int)e.count; i < n; ++i) {
+            int32_t x = list[i];
+            int j = i;
+            while (j > 0 && list[j - 1] > x) { list[j] = list[j - 1]; j--; }
+            list[j] = x;
+        }
+    }
+    *count = n;
+    return list;
+}
+
+// Candidate slots whose names contain every trigram of q, sorted and
+// de-duplicated. Returns NULL with *count = -1 when the index cannot answer
+// (query shorter than a trigram, or index unavailable).
+int32_t *tri_candidates(const char *q, int *count) {
+    *count = -1;
+    uint32_t tris[200];
+    int k = name_trigrams(q, tris, 200);
+    if (k == 0) return NULL;
+    TriHeader h;
+    FILE *fp = tri_open(&h, 1);
+    if (!fp) return NULL;
+    TriDelta *delta = malloc(sizeof(TriDelta) * (h.ndelta + 1));
+    if (!delta) { fclose(fp); return NULL; }
+    fseek(fp, tri_delta_offset(&h), SEEK_SET);
+    if (io_fread(delta, sizeof(TriDelta), h.ndelta, fp) != (size_t)h.ndelta) { free(delta); fclose(fp); return NULL; }
+
+    int32_t *cand = NULL;
+    int n = 0;
+    for (int i = 0; i < k; ++i) {
+        int m;
+        int32_t *list = tri_postings(fp, &h, delta, tris[i], &m);
+        if (!list) { free(cand); cand = NULL; n = -1; break; }
+        if (i == 0) { cand = list; n = m; }
+        else {
+            int a = 0, b = 0, out = 0;
+            while (a < n && b < m) {
+                if (cand[a] < list[b]) a++;
+                else if (cand[a] > list[b]) b++;
+                else { cand[out++] = cand[a]; a++; b++; }
+            }
+            n = out;
+            free(list);
+        }
+        int out = 0;
+        for (int j = 0; j < n; ++j)
+            if (out == 0 || cand[out - 1] != cand[j]) cand[out++] = cand[j];
+        n = out;
+        if (n == 0) break;
+    }
+    free(delta);
+    fclose(fp);
+    *count = n;
+    return cand;
+}
+
+// -------- GRADE BITMAPS (student.gbm) --------
+// One bitmap per grade (A, B, C, D, F) over record slots; deleted slots are
+// in none of them. On disk each bitmap is run-length compressed in 64-bit
+// words: a marker word holds a run of all-zero or all-one words plus the
+// number of literal words that follow it. The decoded bitmaps are cached
+// for the session; changes are applied there and written back together
+// by gbm_flush() (with the journal, before DATA_FILE is replaced, at exit).
+#define GRADE_COUNT 5
+
+typedef struct {
+    char magic[4];              // "SGBM"
+    int32_t slots;              // bits per bitmap
+    int32_t words[GRADE_COUNT]; // encoded length of each bitmap
+    int32_t reserved;
+    DataStamp data;             // DATA_FILE stamp at last sync
+} GbmHeader;
+
+typedef struct {
+    int loaded;
+    int slots;
+    int nwords;
+    uint64_t *bits[GRADE_COUNT];
+    DataStamp stamp;            // DATA_FILE state the bitmaps describe
+    int dirty;                  // changed since GRADE_BITMAP_FILE was written
+} GradeBitmaps;
+
+GradeBitmaps g_gbm;
+
+// Bitmap of grade g: 0..3 for A..D, 4 for F (and anything else), -1 for a
+// deleted slot.
+int grade_bucket(char g) {
+    switch (g) {
+        case 'A': return 0;
+        case 'B': return 1;
+        case 'C': return 2;
+        case 'D': return 3;
+        case DELETED_GRADE: return -1;
+        default: return 4;
+    }
+}
+
+int popcount64(uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x) { x &= x - 1; n++; }
+    return n;
+#endif
+}
+
+int ctz64(uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
 #else
-    return strcasecmp(sa->name, sb->name);
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
 #endif
 }
-int compare_by_percentage_desc(const void *a, const void *b) {
-    const Student *sa = a, *sb = b;
-    if (sb->percentage > sa->percentage) return 1;
-    if (sb->percentage < sa->percentage) return -1;
-    return 0;
+
+void gbm_free(GradeBitmaps *b) {
+    for (int k = 0; k < GRADE_COUNT; ++k) free(b->bits[k]);
+    memset(b, 0, sizeof(*b));
+}
+
+// Make room for at least `slots` bits per bitmap (new bits clear).
+int gbm_reserve(GradeBitmaps *b, int slots) {
+    int need = (slots + 63) / 64;
+    if (need > b->nwords) {
+        int cap = b->nwords ? b->nwords : 16;
+        while (cap < need) cap *= 2;
+        for (int k = 0; k < GRADE_COUNT; ++k) {
+            uint64_t *grown = realloc(b->bits[k], sizeof(uint64_t) * cap);
+            if (!grown) return 0;
+            memset(grown + b->nwords, 0, sizeof(uint64_t) * (cap - b->nwords));
+            b->bits[k] = grown;
+        }
+        b->nwords = cap;
+    }
+    if (slots > b->slots) b->slots = slots;
+    return 1;
+}
+
+// Compress n words into out (room for 2n + 1 words). Returns words written.
+int gbm_encode(const uint64_t *w, int n, uint64_t *out) {
+    int i = 0, o = 0;
+    while (i < n) {
+        uint64_t fill = 0, run = 0, lits = 0;
+        if (w[i] == 0 || w[i] == ~(uint64_t)0) {
+            fill = w[i] ? 1 : 0;
+            while (i < n && w[i] == (fill ? ~(uint64_t)0 : 0) && run < 0xFFFFFFFFu) { run++; i++; }
+        }
+        int first = i;
+        while (i < n && w[i] != 0 && w[i] != ~(uint64_t)0 && lits < 0x7FFFFFFFu) { lits++; i++; }
+        out[o++] = run | (lits << 32) | (fill << 63);
+        for (int k = first; k < i; ++k) out[o++] = w[k];
+    }
+    return o;
+}
+
+// Expand `len` encoded words into w[0..n). Returns 0 on malformed input.
+int gbm_decode(const uint64_t *in, int len, uint64_t *w, int n) {
+    int i = 0, o = 0;
+    while (i < len) {
+        uint64_t m = in[i++];
+        uint64_t run = m & 0xFFFFFFFFu, lits = (m >> 32) & 0x7FFFFFFFu;
+        uint64_t fill = (m >> 63) ? ~(uint64_t)0 : 0;
+        if (run > (uint64_t)(n - o) || lits > (uint64_t)(n - o) - run || lits > (uint64_t)(len - i)) return 0;
+        for (uint64_t k = 0; k < run; ++k) w[o++] = fill;
+        for (uint64_t k = 0; k < lits; ++k) w[o++] = in[i++];
+    }
+    return 1;
+}
+
+int gbm_save(GradeBitmaps *b) {
+    int n = (b->slots + 63) / 64;
+    uint64_t *enc = malloc(sizeof(uint64_t) * (2 * (size_t)n + 1) * GRADE_COUNT);
+    if (!enc) return 0;
+    GbmHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "SGBM", 4);
+    h.slots = b->slots;
+    int total = 0;
+    for (int k = 0; k < GRADE_COUNT; ++k) {
+        h.words[k] = gbm_encode(b->bits[k], n, enc + total);
+        total += h.words[k];
+    }
+    h.data = b->stamp;
+    char temp[256];
+    temp_path(GRADE_BITMAP_FILE, temp, sizeof(temp));
+    FILE *fp = io_fopen(temp, "wb");
+    if (!fp) { free(enc); return 0; }
+    int ok = io_fwrite(&h, sizeof(h), 1, fp) == 1 &&
+             io_fwrite(enc, sizeof(uint64_t), total, fp) == (size_t)total;
+    ok = (fclose(fp) == 0) && ok;
+    free(enc);
+    ok = ok && replace_file(temp, GRADE_BITMAP_FILE) == 0;
+    if (!ok) remove(temp);
+    return ok;
+}
+
+// Load GRADE_BITMAP_FILE into the cache if it describes DATA_FILE as of
+// `want`. Returns 0 if missing, corrupt or out of date.
+int gbm_load(DataStamp want) {
+    FILE *fp = io_fopen(GRADE_BITMAP_FILE, "rb");
+    if (!fp) return 0;
+    GbmHeader h;
+    int ok = io_fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, "SGBM", 4) == 0 &&
+             h.slots >= 0 && stamp_equal(h.data, want);
+    int n = ok ? (h.slots + 63) / 64 : 0;
+    gbm_free(&g_gbm);
+    ok = ok && gbm_reserve(&g_gbm, h.slots);
+    for (int k = 0; ok && k < GRADE_COUNT; ++k) {
+        uint64_t *enc = h.words[k] >= 0 && h.words[k] <= 2 * n + 1 ? malloc(sizeof(uint64_t) * (h.words[k] + 1)) : NULL;
+        ok = enc && io_fread(enc, sizeof(uint64_t), h.words[k], fp) == (size_t)h.words[k] &&
+             gbm_decode(enc, h.words[k], g_gbm.bits[k], n);
+        free(enc);
+    }
+    fclose(fp);
+    if (!ok) { gbm_free(&g_gbm); return 0; }
+    g_gbm.stamp = want;
+    g_gbm.loaded = 1;
+    return 1;
+}
+
+int gbm_rebuild() {
+    StudentView v;
+    int have = data_view(&v);
+    gbm_free(&g_gbm);
+    if (!gbm_reserve(&g_gbm, have ? v.slots : 0)) { gbm_free(&g_gbm); return 0; }
+    if (have) metric_count(MC_SCANNED, (uint64_t)v.slots);
+    for (int slot = 0; have && slot < v.slots; ++slot) {
+        int k = grade_bucket(view_rec(&v, slot)->grade);
+        if (k >= 0) g_gbm.bits[k][slot >> 6] |= (uint64_t)1 << (slot & 63);
+    }
+    g_gbm.stamp = data_stamp();
+    g_gbm.loaded = 1;
+    gbm_save(&g_gbm);
+    return 1;
+}
+
+// Grade bitmaps in sync with DATA_FILE, or NULL if they cannot be built.
+const GradeBitmaps *gbm_get() {
+    DataStamp now = data_stamp();
+    if (g_gbm.loaded && stamp_equal(g_gbm.stamp, now)) return &g_gbm;
+    if (gbm_load(now) || gbm_rebuild()) return &g_gbm;
+    return NULL;
+}
+
+// Slot moved from grade `from` to grade `to` (DELETED_GRADE for none). Only
+// applied when the bitmaps matched DATA_FILE as of `before`.
+void gbm_apply(int slot, char from, char to, DataStamp before) {
+    int synced = g_gbm.loaded && stamp_equal(g_gbm.stamp, before);
+    if (!synced && !gbm_load(before)) { gbm_free(&g_gbm); return; }
+    if (!gbm_reserve(&g_gbm, slot + 1)) { gbm_free(&g_gbm); return; }
+    uint64_t bit = (uint64_t)1 << (slot & 63);
+    int k = grade_bucket(from);
+    if (k >= 0) g_gbm.bits[k][slot >> 6] &= ~bit;
+    k = grade_bucket(to);
+    if (k >= 0) g_gbm.bits[k][slot >> 6] |= bit;
+    g_gbm.stamp = data_stamp();
+    g_gbm.dirty = 1;
+}
+
+// Write the cached bitmaps back if gbm_apply() changed them.
+void gbm_flush() {
+    if (g_gbm.loaded && g_gbm.dirty && gbm_save(&g_gbm)) g_gbm.dirty = 0;
+}
+
+// Union of the bitmaps of the listed grade letters (e.g. "AB"), malloc'd,
+// with *nwords words. NULL if no letter is a grade or bitmaps are missing.
+uint64_t *grade_filter(const char *grades, int *nwords) {
+    const GradeBitmaps *b = gbm_get();
+    int want[GRADE_COUNT] = { 0 }, any = 0;
+    for (const char *p = grades; *p; ++p) {
+        char g = (char)toupper((unsigned char)*p);
+        if (strchr("ABCDF", g)) { want[grade_bucket(g)] = 1; any = 1; }
+    }
+    if (!b || !any) return NULL;
+    int n = (b->slots + 63) / 64;
+    uint64_t *out = calloc(n + 1, sizeof(uint64_t));
+    if (!out) return NULL;
+    for (int k = 0; k < GRADE_COUNT; ++k)
+        if (want[k])
+            for (int i = 0; i < n; ++i) out[i] |= b->bits[k][i];
+    *nwords = n;
+    return out;
+}
+
+// counts[0..4] = A, B, C, D, F by population count.
+int gbm_grade_counts(int counts[GRADE_COUNT]) {
+    const GradeBitmaps *b = gbm_get();
+    if (!b) return 0;
+    int n = (b->slots + 63) / 64;
+    for (int k = 0; k < GRADE_COUNT; ++k) {
+        counts[k] = 0;
+        for (int i = 0; i < n; ++i) counts[k] += popcount64(b->bits[k][i]);
+    }
+    return 1;
+}
+
+// -------- SORTED INDEXES (B+trees: roll, name, percentage) --------
+// One paged B+tree file per sort order. Entries are (key, slot) with keys
+// encoded so that memcmp gives the display order: roll ascending, lowercased
+// name, percentage descending (then roll). Leaves are chained left to right,
+// so a sorted listing is a descent to the first leaf followed by a walk.
+// Entries are only ever added: a deleted record or a changed key leaves a
+// stale entry behind, which readers skip by re-encoding the key from the
+// record. Once stale entries make up a quarter of the tree it is dropped
+// and rebuilt on next use.
+#define BT_ROLL 0
+#define BT_NAME 1
+#define BT_PERCENTAGE 2
+#define BT_KINDS 3
+#define BT_PAGE_SIZE 4096
+#define BT_KEY_LEN 60
+
+const char *const BT_FILES[BT_KINDS] = { BTREE_ROLL_FILE, BTREE_NAME_FILE, BTREE_PERC_FILE };
+
+typedef struct {
+    unsigned char key[BT_KEY_LEN];
+    int32_t slot;
+} BtEntry;
+
+#define BT_LEAF_MAX  ((BT_PAGE_SIZE - 16) / (int)sizeof(BtEntry))
+#define BT_INNER_MAX ((BT_PAGE_SIZE - 16) / (int)(sizeof(BtEntry) + sizeof(int32_t)))
+
+// A leaf holds sorted entries; an inner node holds for each child the
+// smallest entry below it.
+typedef struct {
+    int16_t leaf;
+    int16_t n;
+    int32_t next;       // next leaf page, 0 at the end
+    int32_t reserved[2];
+    union {
+        BtEntry ent[BT_LEAF_MAX];
+        struct {
+            BtEntry key[BT_INNER_MAX];
+            int32_t child[BT_INNER_MAX];
+        } in;
+    } u;
+} BtNode;
+
+typedef struct {
+    char magic[4];      // "SBPT"
+    int32_t kind;
+    int32_t root;       // page number; page 0 holds this header
+    int32_t pages;
+    int32_t entries;
+    int32_t stale;      // entries known to be superseded
+    DataStamp data;     // DATA_FILE stamp at last sync
+} BtHeader;
+
+typedef struct {
+    FILE *fp;
+    BtHeader h;
+} BTree;
+
+void bt_put_be32(unsigned char *p, uint32_t x) {
+    p[0] = (unsigned char)(x >> 24); p[1] = (unsigned char)(x >> 16);
+    p[2] = (unsigned char)(x >> 8);  p[3] = (unsigned char)x;
+}
+
+// Float bits mapped so unsigned comparison matches numeric order.
+uint32_t float_order_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+void bt_make_entry(int kind, const StudentRec *r, int slot, BtEntry *e) {
+    memset(e, 0, sizeof(*e));
+    e->slot = slot;
+    if (kind == BT_ROLL) {
+        bt_put_be32(e->key, (uint32_t)r->rollNo ^ 0x80000000u);
+    } else if (kind == BT_NAME) {
+        for (int i = 0; i < BT_KEY_LEN && i < MAX_NAME_LEN && r->name[i]; ++i)
+            e->key[i] = (unsigned char)tolower((unsigned char)r->name[i]);
+    } else {
+        bt_put_be32(e->key, ~float_order_bits(r->percentage));
+        bt_put_be32(e->key + 4, (uint32_t)r->rollNo ^ 0x80000000u);
+    }
+}
+
+int bt_compare(const BtEntry *a, const BtEntry *b) {
+    int c = memcmp(a->key, b->key, BT_KEY_LEN);
+    if (c) return c;
+    return (a->slot > b->slot) - (a->slot < b->slot);
+}
+
+// Bytes [offset, offset + 8) of the BT_NAME key of r, big-endian.
+uint64_t bt_name_chunk(const StudentRec *r, int offset) {
+    if (offset > 0 && memchr(r->name, 0, offset)) return 0;
+    uint64_t k = 0;
+    int i = offset, end = offset + 8;
+    for (; i < end && i < BT_KEY_LEN && r->name[i]; ++i) k = (k << 8) | (unsigned char)tolower((unsigned char)r->name[i]);
+    return i == offset ? 0 : k << (8 * (end - i));
+}
+
+// The key of r in the tree of `kind` as SortKey chunks: whole for roll and
+// percentage, the first 8 name bytes for names (see bt_sort_chunk).
+uint64_t bt_sort_key(int kind, const StudentRec *r) {
+    uint64_t roll = (uint32_t)r->rollNo ^ 0x80000000u;
+    if (kind == BT_ROLL) return roll << 32;
+    if (kind == BT_NAME) return bt_name_chunk(r, 0);
+    return ((uint64_t)~float_order_bits(r->percentage) << 32) | roll;
+}
+
+uint64_t bt_sort_chunk(void *view, int32_t slot, int depth) {
+    return bt_name_chunk(view_rec(view, slot), depth * 8);
+}
+
+int bt_read(BTree *t, int page, BtNode *node) {
+    return fseek(t->fp, (long)page * BT_PAGE_SIZE, SEEK_SET) == 0 &&
+           io_fread(node, sizeof(*node), 1, t->fp) == 1;
+}
+
+int bt_write(BTree *t, int page, const BtNode *node) {
+    return fseek(t->fp, (long)page * BT_PAGE_SIZE, SEEK_SET) == 0 &&
+           io_fwrite(node, sizeof(*node), 1, t->fp) == 1;
+}
+
+void bt_write_header(BTree *t) {
+    fseek(t->fp, 0, SEEK_SET);
+    io_fwrite(&t->h, sizeof(t->h), 1, t->fp);
+}
+
+// Bulk-load the tree of `kind` from the live records of DATA_FILE: sort
+// (key, slot) pairs, write leaves left to right, then each inner level.
+int bt_rebuild(int kind) {
+    StudentView v;
+    int have = data_view(&v);
+    int n = 0;
+    SortKey *keys = malloc(sizeof(SortKey) * ((have ? v.slots : 0) + 1));
+    if (!keys) return 0;
+    if (have) metric_count(MC_SCANNED, (uint64_t)v.slots);
+    for (int slot = 0; have && slot < v.slots; ++slot) {
+        const StudentRec *r = view_rec(&v, slot);
+        if (is_deleted(r)) continue;
+        keys[n].key = bt_sort_key(kind, r);
+        keys[n++].idx = slot;
+    }
+    // input is in slot order and the sort is stable: ties stay in slot order, as in bt_compare
+    int chunks = kind == BT_NAME ? (BT_KEY_LEN + 7) / 8 : 1;
+    if (!sort_keys(keys, n, kind == BT_NAME ? bt_sort_chunk : NULL, &v, chunks)) { free(keys); return 0; }
+
+    BTree t;
+    char temp[256];
+    temp_path(BT_FILES[kind], temp, sizeof(temp));
+    t.fp = io_fopen(temp, "w+b");
+    if (!t.fp) { free(keys); return 0; }
+    memset(&t.h, 0, sizeof(t.h));
+    memcpy(t.h.magic, "SBPT", 4);
+    t.h.kind = kind;
+    t.h.entries = n;
+    t.h.pages = 1;
+
+    // leaves are filled to 7/8 to leave room for inserts
+    int per_leaf = BT_LEAF_MAX * 7 / 8, per_inner = BT_INNER_MAX * 7 / 8;
+    int level_n = n > 0 ? (n + per_leaf - 1) / per_leaf : 1;
+    BtEntry *level_min = malloc(sizeof(BtEntry) * level_n);
+    int32_t *level_page = malloc(sizeof(int32_t) * level_n);
+    int ok = level_min && level_page;
+    BtNode node;
+    for (int i = 0; ok && i < level_n; ++i) {
+        memset(&node, 0, sizeof(node));
+        node.leaf = 1;
+        int first = i * per_leaf;
+        node.n = (int16_t)(n - first < per_leaf ? n - first : per_leaf);
+        for (int k = 0; k < node.n; ++k) {
+            int slot = keys[first + k].idx;
+            bt_make_entry(kind, view_rec(&v, slot), slot, &node.u.ent[k]);
+        }
+        node.next = i + 1 < level_n ? t.h.pages + 1 : 0;
+        if (node.n > 0) level_min[i] = node.u.ent[0]; else memset(&level_min[i], 0, sizeof(BtEntry));
+        level_page[i] = t.h.pages;
+        ok = bt_write(&t, t.h.pages++, &node);
+    }
+    while (ok && level_n > 1) {
+        int up = (level_n + per_inner - 1) / per_inner;
+        for (int i = 0; ok && i < up; ++i) {
+            memset(&node, 0, sizeof(node));
+            int first = i * per_inner;
+            node.n = (int16_t)(level_n - first < per_inner ? level_n - first : per_inner);
+            for (int k = 0; k < node.n; ++k) {
+                node.u.in.key[k] = level_min[first + k];
+                node.u.in.child[k] = level_page[first + k];
+            }
+            level_min[i] = node.u.in.key[0];
+            level_page[i] = t.h.pages;
+            ok = bt_write(&t, t.h.pages++, &node);
+        }
+        level_n = up;
+    }
+    if (ok) t.h.root = level_page[0];
+    data_file_stamp(&t.h.data);
+    bt_write_header(&t);
+    ok = (fclose(t.fp) == 0) && ok;
+    free(level_min);
+    free(level_page);
+    free(keys);
+    ok = ok && replace_file(temp, BT_FILES[kind]) == 0;
+    if (!ok) remove(temp);
+    return ok;
+}
+
+// Open the tree of `kind`. With validate set, a missing, corrupt or stale
+// tree is rebuilt first. Close with bt_close().
+int bt_open(int kind, BTree *t, int validate) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        t->fp = io_fopen(BT_FILES[kind], "r+b");
+        if (t->fp) {
+            if (io_fread(&t->h, sizeof(t->h), 1, t->fp) == 1 && memcmp(t->h.magic, "SBPT", 4) == 0 &&
+                t->h.kind == kind && t->h.root > 0 && t->h.root < t->h.pages) {
+                if (!validate) return 1;
+                if (stamp_equal(data_stamp(), t->h.data)) return 1;
+            }
+            fclose(t->fp);
+            t->fp = NULL;
+        }
+        if (!validate || !bt_rebuild(kind)) return 0;
+    }
+    return 0;
+}
+
+void bt_close(BTree *t) {
+    if (t->fp) fclose(t->fp);
+    t->fp = NULL;
+}
+
+// Insert e below `page`. Returns -1 on error, 0 if e was added (or already
+// present), 1 if the node split: the new right sibling is *split_page with
+// smallest entry *split_min.
+int bt_insert_at(BTree *t, int page, const BtEntry *e, BtEntry *split_min, int32_t *split_page) {
+    BtNode node;
+    if (!bt_read(t, page, &node)) return -1;
+    int n = node.n;
+    if (node.leaf) {
+        int pos = 0;
+        while (pos < n && bt_compare(&node.u.ent[pos], e) < 0) pos++;
+        if (pos < n && bt_compare(&node.u.ent[pos], e) == 0) return 0;
+        BtEntry all[BT_LEAF_MAX + 1];
+        memcpy(all, node.u.ent, sizeof(BtEntry) * pos);
+        all[pos] = *e;
+        memcpy(all + pos + 1, node.u.ent + pos, sizeof(BtEntry) * (n - pos));
+        t->h.entries++;
+        if (n + 1 <= BT_LEAF_MAX) {
+            memcpy(node.u.ent, all, sizeof(BtEntry) * (n + 1));
+            node.n = (int16_t)(n + 1);
+            return bt_write(t, page, &node) ? 0 : -1;
+        }
+        BtNode right;
+        memset(&right, 0, sizeof(right));
+        right.leaf = 1;
+        int left_n = (n + 1) / 2;
+        node.n = (int16_t)left_n;
+        right.n = (int16_t)(n + 1 - left_n);
+        memcpy(node.u.ent, all, sizeof(BtEntry) * left_n);
+        memcpy(right.u.ent, all + left_n, sizeof(BtEntry) * right.n);
+        right.next = node.next;
+        *split_page = t->h.pages++;
+        node.next = *split_page;
+        *split_min = right.u.ent[0];
+        return bt_write(t, *split_page, &right) && bt_write(t, page, &node) ? 1 : -1;
+    }
+
+    int i = 0;
+    while (i + 1 < n && bt_compare(&node.u.in.key[i + 1], e) <= 0) i++;
+    if (bt_compare(e, &node.u.in.key[0]) < 0) {
+        node.u.in.key[0] = *e; // new smallest entry of this subtree
+        if (!bt_write(t, page, &node)) return -1;
+    }
+    BtEntry child_min;
+    int32_t child_page;
+    int rc = bt_insert_at(t, node.u.in.child[i], e, &child_min, &child_page);
+    if (rc != 1) return rc;
+
+    BtEntry keys[BT_INNER_MAX + 1];
+    int32_t kids[BT_INNER_MAX + 1];
+    memcpy(keys, node.u.in.key, sizeof(BtEntry) * (i + 1));
+    memcpy(kids, node.u.in.child, sizeof(int32_t) * (i + 1));
+    keys[i + 1] = child_min;
+    kids[i + 1] = child_page;
+    memcpy(keys + i + 2, node.u.in.key + i + 1, sizeof(BtEntry) * (n - i - 1));
+    memcpy(kids + i + 2, node.u.in.child + i + 1, sizeof(int32_t) * (n - i - 1));
+    if (n + 1 <= BT_INNER_MAX) {
+        memcpy(node.u.in.key, keys, sizeof(BtEntry) * (n + 1));
+        memcpy(node.u.in.child, kids, sizeof(int32_t) * (n + 1));
+        node.n = (int16_t)(n + 1);
+        return bt_write(t, page, &node) ? 0 : -1;
+    }
+    BtNode right;
+    memset(&right, 0, sizeof(right));
+    int left_n = (n + 1) / 2;
+    node.n = (int16_t)left_n;
+    right.n = (int16_t)(n + 1 - left_n);
+    memcpy(node.u.in.key, keys, sizeof(BtEntry) * left_n);
+    memcpy(node.u.in.child, kids, sizeof(int32_t) * left_n);
+    memcpy(right.u.in.key, keys + left_n, sizeof(BtEntry) * right.n);
+    memcpy(right.u.in.child, kids + left_n, sizeof(int32_t) * right.n);
+    *split_page = t->h.pages++;
+    *split_min = right.u.in.key[0];
+    return bt_write(t, *split_page, &right) && bt_write(t, page, &node) ? 1 : -1;
+}
+
+int bt_insert(BTree *t, const BtEntry *e) {
+    BtEntry split_min;
+    int32_t split_page;
+    int old_root = t->h.root;
+    int rc = bt_insert_at(t, old_root, e, &split_min, &split_page);
+    if (rc != 1) return rc == 0;
+    BtNode old, root;
+    if (!bt_read(t, old_root, &old)) return 0;
+    memset(&root, 0, sizeof(root));
+    root.n = 2;
+    root.u.in.key[0] = old.leaf ? old.u.ent[0] : old.u.in.key[0];
+    root.u.in.child[0] = old_root;
+    root.u.in.key[1] = split_min;
+    root.u.in.child[1] = split_page;
+    t->h.root = t->h.pages++;
+    return bt_write(t, t->h.root, &root);
+}
+
+// Bring the trees up to date after a record was written at slot. old is
+// the previous image (NULL for an append), s the new one (NULL when the
+// record was deleted). Trees out of sync as of `before` are left stale.
+void bt_apply(int slot, const Student *old_s, const Student *new_s, DataStamp before) {
+    uint32_t old_buf[MAX_RECORD_SIZE / sizeof(uint32_t)], new_buf[MAX_RECORD_SIZE / sizeof(uint32_t)];
+    const StudentRec *old = old_s ? (const StudentRec *)old_buf : NULL;
+    const StudentRec *s = new_s ? (const StudentRec *)new_buf : NULL;
+    if (old_s) student_to_rec(old_s, (StudentRec *)old_buf);
+    if (new_s) student_to_rec(new_s, (StudentRec *)new_buf);
+    for (int kind = 0; kind < BT_KINDS; ++kind) {
+        BTree t;
+        if (!bt_open(kind, &t, 0)) continue;
+        int ok = stamp_equal(t.h.data, before);
+        BtEntry eo, en;
+        if (old) bt_make_entry(kind, old, slot, &eo);
+        if (s) bt_make_entry(kind, s, slot, &en);
+        int changed = !old || !s || bt_compare(&eo, &en) != 0;
+        if (ok && old && changed) t.h.stale++;
+        if (ok && s && changed) ok = bt_insert(&t, &en);
+        if (ok && t.h.stale * 4 > t.h.entries) ok = 0;
+        if (ok) {
+            data_file_stamp(&t.h.data);
+            bt_write_header(&t);
+        }
+        bt_close(&t);
+        if (!ok) remove(BT_FILES[kind]); // rebuilt on next use
+    }
+}
+
+// Position in the leaf chain of a tree.
+typedef struct {
+    int32_t leaf;       // 0 past the end
+    int32_t pos;
+} BtCursor;
+
+// Cursor on the first entry of the tree.
+BtCursor bt_first(BTree *t) {
+    BtCursor c = { t->h.root, 0 };
+    BtNode node;
+    for (int depth = 0; depth < 64; ++depth) {
+        if (!bt_read(t, c.leaf, &node)) { c.leaf = 0; break; }
+        if (node.leaf) break;
+        c.leaf = node.u.in.child[0];
+    }
+    return c;
+}
+
+// Next live record in tree order, skipping stale entries; NULL at the end.
+// `node` caches the current leaf between calls (n = -1 before the first).
+const StudentRec *bt_next(BTree *t, BtCursor *c, BtNode *node, const StudentView *v) {
+    int kind = t->h.kind;
+    while (c->leaf > 0) {
+        if (node->n < 0 && !bt_read(t, c->leaf, node)) { c->leaf = 0; return NULL; }
+        if (c->pos >= node->n) {
+            c->leaf = node->next;
+            c->pos = 0;
+            node->n = -1;
+            continue;
+        }
+        const BtEntry *e = &node->u.ent[c->pos++];
+        if (e->slot < 0 || e->slot >= v->slots) continue;
+        const StudentRec *r = view_rec(v, e->slot);
+        if (is_deleted(r)) continue;
+        BtEntry cur;
+        bt_make_entry(kind, r, e->slot, &cur);
+        if (bt_compare(&cur, e) == 0) return r;
+    }
+    return NULL;
+}
+
+// -------- CLASS STATS SIDECAR (student.sta) --------
+// Running aggregates of the live records, kept up to date by the write
+// hooks with delta arithmetic so the analytics screen does not rescan the
+// class. Sums and counts are always exact. An extreme (highest, lowest,
+// subject maximum) only becomes unknown when the record holding it is
+// removed or worsened; it is then flagged dirty and recomputed from the
+// columns on the next read (see class_stats()).
+#define STATS_DIRTY_HIGHEST 1
+#define STATS_DIRTY_LOWEST  2
+#define STATS_DIRTY_SUBJECT(j) (4 << (j))
+
+typedef struct {
+    char magic[4];      // "SSTA"
+    int32_t subjects;
+    int32_t count;
+    int32_t dirty;      // STATS_DIRTY_* bits of extremes to recompute
+    int32_t grade_counts[5];
+    int32_t highest_slot, lowest_slot;  // -1 when unknown
+    float highest, lowest;
+    int32_t subj_topper_slot[MAX_SUBJECTS];
+    float subj_max[MAX_SUBJECTS];
+    double sum_percentage;
+    double subj_sum[MAX_SUBJECTS];
+    DataStamp data;     // DATA_FILE stamp at last sync
+} StatsFile;
+
+// Read STATS_FILE. Returns 0 if missing, corrupt or for another layout.
+int stats_read(StatsFile *sf) {
+    FILE *fp = io_fopen(STATS_FILE, "rb");
+    if (!fp) return 0;
+    int ok = io_fread(sf, sizeof(*sf), 1, fp) == 1 && memcmp(sf->magic, "SSTA", 4) == 0 &&
+             sf->subjects == SUBJECT_COUNT && sf->count >= 0;
+    fclose(fp);
+    return ok;
+}
+
+int stats_write(StatsFile *sf) {
+    memcpy(sf->magic, "SSTA", 4);
+    sf->subjects = SUBJECT_COUNT;
+    data_file_stamp(&sf->data);
+    char temp[256];
+    temp_path(STATS_FILE, temp, sizeof(temp));
+    FILE *fp = io_fopen(temp, "wb");
+    if (!fp) return 0;
+    int ok = io_fwrite(sf, sizeof(*sf), 1, fp) == 1;
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && replace_file(temp, STATS_FILE) == 0;
+    if (!ok) remove(temp);
+    return ok;
+}
+
+// Follow one extreme as the value at slot changes to new_v (has_new 0:
+// the record went away). Ties go to the lower slot, as in col_argext().
+void stats_track(float *best, int32_t *best_slot, int32_t *dirty, int bit,
+                 int slot, int has_new, float new_v, int want_max) {
+    if (*dirty & bit) return;
+    if (slot == *best_slot) {
+        if (has_new && (want_max ? new_v >= *best : new_v <= *best)) *best = new_v;
+        else *dirty |= bit;
+        return;
+    }
+    if (!has_new) return;
+    int wins = *best_slot < 0 || (want_max ? new_v > *best : new_v < *best) ||
+               (new_v == *best && slot < *best_slot);
+    if (wins) { *best = new_v; *best_slot = slot; }
+}
+
+// Record at slot changed from old to s (either may be NULL: append or
+// delete). Skipped, leaving the sidecar stale, unless it was in sync with
+// DATA_FILE as of `before`.
+void stats_apply(int slot, const Student *old, const Student *s, DataStamp before) {
+    StatsFile sf;
+    if (!stats_read(&sf)) return;
+    if (!stamp_equal(sf.data, before)) return;
+    if (old) {
+        sf.count--;
+        sf.sum_percentage -= old->percentage;
+        for (int j = 0; j < SUBJECT_COUNT; ++j) sf.subj_sum[j] -= old->marks[j];
+        int k = grade_bucket(old->grade);
+        if (k >= 0) sf.grade_counts[k]--;
+    }
+    if (s) {
+        sf.count++;
+        sf.sum_percentage += s->percentage;
+        for (int j = 0; j < SUBJECT_COUNT; ++j) sf.subj_sum[j] += s->marks[j];
+        int k = grade_bucket(s->grade);
+        if (k >= 0) sf.grade_counts[k]++;
+    }
+    float p = s ? s->percentage : 0.0f;
+    stats_track(&sf.highest, &sf.highest_slot, &sf.dirty, STATS_DIRTY_HIGHEST, slot, s != NULL, p, 1);
+    stats_track(&sf.lowest, &sf.lowest_slot, &sf.dirty, STATS_DIRTY_LOWEST, slot, s != NULL, p, 0);
+    for (int j = 0; j < SUBJECT_COUNT; ++j)
+        stats_track(&sf.subj_max[j], &sf.subj_topper_slot[j], &sf.dirty, STATS_DIRTY_SUBJECT(j),
+                    slot, s != NULL, s ? s->marks[j] : 0.0f, 1);
+    if (sf.count == 0) {
+        sf.dirty = 0;
+        sf.highest_slot = sf.lowest_slot = -1;
+        for (int j = 0; j < SUBJECT_COUNT; ++j) sf.subj_topper_slot[j] = -1;
+    }
+    stats_write(&sf);
+}
+
+// -------- INDEX MAINTENANCE --------
+// Every write to DATA_FILE reports to these hooks so the sidecar indexes
+// follow it. `before` is the DATA_FILE stamp taken ahead of the write.
+void sketch_restamp(DataStamp before); // see DISTRIBUTION STATISTICS
+
+void indexes_on_add(int slot, const Student *s, DataStamp before) {
+    index_insert(s->rollNo, slot);
+    tri_add(slot, s->name, before);
+    gbm_apply(slot, DELETED_GRADE, s->grade, before);
+    bt_apply(slot, NULL, s, before);
+    stats_apply(slot, NULL, s, before);
+    sketch_restamp(before);
+}
+
+void indexes_on_update(int slot, const Student *old, const Student *s, DataStamp before) {
+    index_touch();
+    tri_add(slot, strcmp(old->name, s->name) != 0 ? s->name : NULL, before);
+    gbm_apply(slot, old->grade, s->grade, before);
+    bt_apply(slot, old, s, before);
+    stats_apply(slot, old, s, before);
+    if (memcmp(old->marks, s->marks, sizeof(float) * SUBJECT_COUNT) != 0 || old->percentage != s->percentage) remove(SKETCH_FILE);
+}
+
+void indexes_on_delete(int slot, const Student *old, DataStamp before) {
+    index_remove(old->rollNo);
+    tri_add(slot, NULL, before);
+    gbm_apply(slot, old->grade, DELETED_GRADE, before);
+    bt_apply(slot, old, NULL, before);
+    stats_apply(slot, old, NULL, before);
+    remove(SKETCH_FILE);
+}
+
+// DATA_FILE was replaced or rewritten wholesale. The roll index is needed
+// by every operation and is rebuilt now; the rest rebuild on first use.
+void indexes_rebuild_all() {
+    MetricScope m;
+    metric_begin(&m, MOP_INDEX_REBUILD);
+    index_rebuild(IDX_MIN_CAPACITY);
+    remove(TRIGRAM_FILE);
+    remove(GRADE_BITMAP_FILE);
+    gbm_free(&g_gbm);
+    for (int kind = 0; kind < BT_KINDS; ++kind) remove(BT_FILES[kind]);
+    remove(STATS_FILE);
+    remove(SKETCH_FILE);
+    metric_end(&m, 0);
+}
+
+// -------- IN-PLACE SLOT WRITES (student.jnl) --------
+// A slot is overwritten in place through a DATA_FILE handle kept open for
+// the session. The new image is first appended and synced to JOURNAL_FILE;
+// the slot write itself only reaches the page cache (where the data view
+// already sees it), and DATA_FILE is synced lazily: every
+// JOURNAL_FLUSH_ENTRIES updates, before the file is replaced, and on exit.
+// Then the journal is removed. After a crash journal_recover() replays the
+// entries in order; a torn last entry fails its checksum and is dropped,
+// because its slot write had not happened yet.
+// Every session with pending writes holds a shared flock() on the journal;
+// it is only replayed or removed under an exclusive one, so a journal that
+// live sessions still depend on is never touched by another process.
+#define JOURNAL_FLUSH_ENTRIES 256
+
+typedef struct {
+    char magic[4];      // "SJNL"
+    int32_t slot;
+    Student rec;
+    uint32_t checksum;  // FNV-1a over slot + rec
+} JournalEntry;
+
+struct {
+    FILE *fp;           // DATA_FILE, "r+b"
+    int64_t ino;
+    FILE *jp;           // JOURNAL_FILE, appended to
+    int64_t jino;
+    int pending;        // journaled writes DATA_FILE has not synced yet
+} g_writer;
+
+uint32_t journal_checksum(const JournalEntry *j) {
+    uint32_t h = fnv1a(2166136261u, &j->slot, sizeof(j->slot));
+    return fnv1a(h, &j->rec, sizeof(j->rec));
+}
+
+// The session's DATA_FILE handle, reopened if the file was replaced.
+FILE *data_writer() {
+    struct stat st;
+    int present = stat(DATA_FILE, &st) == 0;
+    if (g_writer.fp && present && (int64_t)st.st_ino == g_writer.ino) return g_writer.fp;
+    if (g_writer.fp) fclose(g_writer.fp);
+    g_writer.fp = present ? io_fopen(DATA_FILE, "r+b") : NULL;
+    g_writer.ino = present ? (int64_t)st.st_ino : 0;
+    return g_writer.fp;
+}
+
+// Lock fp (JOURNAL_FILE) shared or exclusive. A shared lock waits for an
+// exclusive holder, which is brief; an exclusive one is only tried. Also
+// fails when JOURNAL_FILE was removed or replaced before the lock was
+// granted. No-op on Windows, which has no daemon to share the file with.
+int journal_lock(FILE *fp, int exclusive) {
+#ifdef _WIN32
+    (void)fp; (void)exclusive;
+    return 1;
+#else
+    struct stat held, now;
+    if (flock(fileno(fp), exclusive ? LOCK_EX | LOCK_NB : LOCK_SH) != 0) return 0;
+    return fstat(fileno(fp), &held) == 0 && stat(JOURNAL_FILE, &now) == 0 && held.st_ino == now.st_ino;
+#endif
+}
+
+// Remove JOURNAL_FILE unless another session still has writes pending in it.
+void journal_retire() {
+    FILE *jp = io_fopen(JOURNAL_FILE, "rb");
+    if (!jp) return;
+    if (journal_lock(jp, 1)) remove(JOURNAL_FILE);
+    fclose(jp);
+}
+
+// Write back the grade bitmaps, sync the slot writes made so far and retire
+// the journal. Returns 1 on success (the journal stays if DATA_FILE could
+// not be synced).
+int journal_flush() {
+    gbm_flush();
+    if (g_writer.pending == 0 && !g_writer.jp && !g_writer.fp) return 1;
+    MetricScope m;
+    metric_begin(&m, MOP_JOURNAL_FLUSH);
+    int ok = 1;
+    if (g_writer.pending > 0) ok = g_writer.fp && sync_file(g_writer.fp);
+    if (!ok) return metric_end(&m, 0);
+    if (g_writer.jp) {
+        fclose(g_writer.jp); // drops our shared lock
+        g_writer.jp = NULL;
+        journal_retire();
+    }
+    g_writer.pending = 0;
+    if (g_writer.fp) { fclose(g_writer.fp); g_writer.fp = NULL; } // let the file be replaced (Windows)
+    return metric_end(&m, 1);
+}
+
+void journal_flush_at_exit() { journal_flush(); }
+
+// Append one entry to the journal and make it durable.
+int journal_append(const JournalEntry *j) {
+    struct stat st;
+    if (g_writer.jp && (stat(JOURNAL_FILE, &st) != 0 || (int64_t)st.st_ino != g_writer.jino)) {
+        fclose(g_writer.jp); // another process recovered (and removed) it
+        g_writer.jp = NULL;
+    }
+    for (int attempt = 0; !g_writer.jp; ++attempt) {
+        if (attempt == 3) return 0;
+        g_writer.jp = io_fopen(JOURNAL_FILE, "ab");
+        if (!g_writer.jp) return 0;
+        if (!journal_lock(g_writer.jp, 0) || fstat(fileno(g_writer.jp), &st) != 0) {
+            fclose(g_writer.jp); // removed while we waited: start a new one
+            g_writer.jp = NULL;
+            continue;
+        }
+        g_writer.jino = (int64_t)st.st_ino;
+    }
+    return io_fwrite(j, sizeof(*j), 1, g_writer.jp) == 1 && sync_file(g_writer.jp);
+}
+
+int write_slot_raw(int slot, const Student *s) {
+    uint32_t buf[MAX_RECORD_SIZE / sizeof(uint32_t)];
+    StudentRec *rec = (StudentRec *)buf;
+    student_to_rec(s, rec);
+    FILE *fp = data_writer();
+    if (!fp) return 0;
+    int ok = fseek(fp, slot_offset(slot), SEEK_SET) == 0 &&
+             io_fwrite(rec, RECORD_SIZE, 1, fp) == 1 && fflush(fp) == 0;
+    data_view_written(fp, slot_offset(slot), rec, RECORD_SIZE);
+    return ok;
+}
+
+// Append count encoded records after the last whole slot of DATA_FILE
+// (creating the file if needed) with a single write. Returns the slot of
+// the first one, or -1 on error.
+int append_records(const void *recs, int count) {
+    if (!data_file_create()) return -1;
+    if (g_storage_log) {
+        StudentView v;
+        log_lock(); // the slot count must not move before our entry is in
+        int ok = log_image_sync() && data_view(&v) && log_write(v.slots, recs, count);
+        log_unlock();
+        return ok ? v.slots : -1;
+    }
+    FILE *fp = data_writer();
+    if (!fp) return -1;
+    file_lock(fp); // another process appending would pick the same slot
+    fseek(fp, 0, SEEK_END);
+    int slot = (int)((ftell(fp) - DATA_HEADER_SIZE) / RECORD_SIZE);
+    int ok = fseek(fp, slot_offset(slot), SEEK_SET) == 0 &&
+             io_fwrite(recs, RECORD_SIZE, count, fp) == (size_t)count && fflush(fp) == 0;
+    file_unlock(fp);
+    data_view_written(fp, slot_offset(slot), recs, (size_t)count * RECORD_SIZE);
+    return ok ? slot : -1;
+}
+
+int append_record(const Student *s) {
+    uint32_t buf[MAX_RECORD_SIZE / sizeof(uint32_t)];
+    StudentRec *rec = (StudentRec *)buf;
+    student_to_rec(s, rec);
+    return append_records(rec, 1);
+}
+
+// Read slot into s. Returns 0 if the slot does not exist.
+int read_slot(int slot, Student *s) {
+    StudentView v;
+    if (!data_view(&v) || slot < 0 || slot >= v.slots) return 0;
+    rec_to_student(view_rec(&v, slot), v.subjects, s);
+    return 1;
+}
+
+// Overwrite one record slot of DATA_FILE, crash-safe. Returns 1 on success.
+int write_slot(int slot, const Student *s) {
+    if (g_storage_log) {
+        uint32_t buf[MAX_RECORD_SIZE / sizeof(uint32_t)];
+        student_to_rec(s, (StudentRec *)buf);
+        return log_write(slot, buf, 1);
+    }
+    JournalEntry j;
+    memset(&j, 0, sizeof(j));
+    memcpy(j.magic, "SJNL", 4);
+    j.slot = slot;
+    j.rec = *s;
+    j.checksum = journal_checksum(&j);
+
+    if (!journal_append(&j)) return 0;
+    g_writer.pending++;
+    if (!write_slot_raw(slot, s)) return 0; // the journal replays it next start
+    if (g_writer.pending >= JOURNAL_FLUSH_ENTRIES) journal_flush();
+    return 1;
+}
+
+// Replay the slot writes a crash left in the journal. Called once at startup;
+// a journal another session holds is live, not left over, and is skipped.
+void journal_recover() {
+    FILE *jp = io_fopen(JOURNAL_FILE, "rb");
+    if (!jp) return;
+    if (!journal_lock(jp, 1)) { fclose(jp); return; }
+    JournalEntry j;
+    int replayed = 0;
+    while (io_fread(&j, sizeof(j), 1, jp) == 1 && memcmp(j.magic, "SJNL", 4) == 0 &&
+           j.checksum == journal_checksum(&j) && j.slot >= 0) {
+        if (!write_slot_raw(j.slot, &j.rec)) { fclose(jp); return; } // keep journal, retry next start
+        replayed++;
+    }
+    g_writer.pending = replayed;
+    if (!journal_flush()) { fclose(jp); return; }
+    remove(JOURNAL_FILE); // journal_flush only removes a journal it opened
+    fclose(jp);
+    if (replayed) {
+        indexes_rebuild_all();
+        fprintf(stderr, COL_YELLOW "Replayed %d journaled update(s).\n" COL_RESET, replayed);
+    }
+}
+
+// -------- CORE: file operations, validation --------
+// Result codes of the core operations shared by the menu and the command line.
+#define OP_OK        0
+#define OP_NOT_FOUND 1
+#define OP_DUPLICATE 2
+#define OP_IO_ERROR  3
+#define OP_BAD_REQUEST 4 // daemon: malformed request
+
+int roll_exists(int roll) {
+    MetricScope m;
+    metric_begin(&m, MOP_ROLL_EXISTS);
+    return metric_end(&m, index_lookup(roll) >= 0);
+}
+
+void recalc_student(Student *s) {
+    s->total = 0.0f;
+    for (int i = 0; i < SUBJECT_COUNT; ++i) s->total += s->marks[i];
+    s->percentage = s->total / SUBJECT_COUNT;
+    if (s->percentage >= 90.0f) s->grade = 'A';
+    else if (s->percentage >= 75.0f) s->grade = 'B';
+    else if (s->percentage >= 60.0f) s->grade = 'C';
+    else if (s->percentage >= 40.0f) s->grade = 'D';
+    else s->grade = 'F';
+}
+
+// -------- ADD STUDENT --------
+// Recalculate and store a new student.
+int add_student(Student *s) {
+    MetricScope m;
+    metric_begin(&m, MOP_ADD);
+    if (roll_exists(s->rollNo)) return metric_end(&m, OP_DUPLICATE);
+    recalc_student(s);
+    DataStamp before = data_stamp();
+    int slot = append_record(s);
+    if (slot < 0) return metric_end(&m, OP_IO_ERROR);
+    indexes_on_add(slot, s, before);
+    return metric_end(&m, OP_OK);
+}
+
+void addStudent_feature() {
+    Student s;
+    clear_screen();
+    printf(COL_CYAN "----- Add Student -----\n" COL_RESET);
+
+    printf("Enter Roll Number: ");
+    if (scanf("%d", &s.rollNo) != 1) {
+        printf(COL_RED "Invalid input.\n" COL_RESET);
+        while (getchar() != '\n');
+        pause_anykey();
+        return;
+    }
+    while (getchar() != '\n');
+
+    if (roll_exists(s.rollNo)) {
+        printf(COL_RED "Roll number already exists. Aborting.\n" COL_RESET);
+        pause_anykey();
+        return;
+    }
+
+    printf("Enter Full Name: ");
+    safe_fgets(s.name, sizeof(s.name));
+    if (strlen(s.name) == 0) strcpy(s.name, "Unnamed Student");
+    to_titlecase(s.name);
+
+    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+        printf("Enter marks for %s: ", SUBJECT_NAMES[i]);
+        if (scanf("%f", &s.marks[i]) != 1) {
+            printf(COL_RED "Invalid input.\n" COL_RESET);
+            while (getchar() != '\n');
+            pause_anykey();
+            return;
+        }
+    }
+    while (getchar() != '\n');
+
+    int rc = add_student(&s);
+    if (rc == OP_DUPLICATE) { printf(COL_RED "Roll number already exists. Aborting.\n" COL_RESET); pause_anykey(); return; }
+    if (rc != OP_OK) { printf(COL_RED "Error opening data file.\n" COL_RESET); pause_anykey(); return; }
+
+    printf(COL_GREEN "Student added successfully.\n" COL_RESET);
+    pause_anykey();
+}
+
+// -------- BULK IMPORT --------
+// One student per line:  roll|name|marks1|marks2|...  (one mark per
+// subject; blank lines and lines starting with '#' are skipped). Rolls are
+// checked against an in-memory set of existing and already-accepted rolls,
+// and accepted records are appended in large batches.
+#define IMPORT_BATCH 65536
+
+typedef struct {
+    int32_t *keys;
+    unsigned char *used;
+    int capacity;           // power of two
+    int count;
+} RollSet;
+
+int rollset_init(RollSet *set, int expected) {
+    set->capacity = 64;
+    while (set->capacity < expected * 2) set->capacity *= 2;
+    set->count = 0;
+    set->keys = malloc(sizeof(int32_t) * set->capacity);
+    set->used = calloc(set->capacity, 1);
+    return set->keys && set->used;
+}
+
+void rollset_free(RollSet *set) {
+    free(set->keys);
+    free(set->used);
+    memset(set, 0, sizeof(*set));
+}
+
+// Insert roll; returns 0 if it was already present (or on allocation failure).
+int rollset_add(RollSet *set, int roll) {
+    if ((set->count + 1) * 2 > set->capacity) {
+        RollSet bigger;
+        if (!rollset_init(&bigger, set->capacity)) return 0;
+        for (int i = 0; i < set->capacity; ++i)
+            if (set->used[i]) rollset_add(&bigger, set->keys[i]);
+        rollset_free(set);
+        *set = bigger;
+    }
+    unsigned i = idx_hash(roll, set->capacity);
+    while (set->used[i]) {
+        if (set->keys[i] == roll) return 0;
+        i = (i + 1) & (set->capacity - 1);
+    }
+    set->used[i] = 1;
+    set->keys[i] = roll;
+    set->count++;
+    return 1;
+}
+
+char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    size_t n = strlen(s);
+    while (n > 0 && isspace((unsigned char)s[n - 1])) s[--n] = '\0';
+    return s;
+}
+
+// Parse one import line into s. Returns NULL on success or an error message.
+const char *parse_import_line(char *line, Student *s) {
+    char *fields[MAX_SUBJECTS + 3];
+    int nf = 0;
+    char *p = line;
+    while (nf < MAX_SUBJECTS + 3) {
+        fields[nf++] = p;
+        char *bar = strchr(p, '|');
+        if (!bar) break;
+        *bar = '\0';
+        p = bar + 1;
+    }
+    if (nf != SUBJECT_COUNT + 2) return "wrong number of fields";
+    memset(s, 0, sizeof(*s));
+    char *end;
+    long roll = strtol(trim(fields[0]), &end, 10);
+    if (*fields[0] == '\0' || *end != '\0') return "invalid roll number";
+    s->rollNo = (int)roll;
+    strncpy(s->name, trim(fields[1]), sizeof(s->name) - 1);
+    if (strlen(s->name) == 0) strcpy(s->name, "Unnamed Student");
+    to_titlecase(s->name);
+    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+        char *f = trim(fields[i + 2]);
+        s->marks[i] = strtof(f, &end);
+        if (*f == '\0' || *end != '\0') return "invalid marks";
+    }
+    return NULL;
+}
+
+// Import records from in. Returns the number imported (or -1 if the data
+// file could not be written); rejected lines are reported on stderr.
+int import_students(FILE *in, int *rejected) {
+    MetricScope m;
+    metric_begin(&m, MOP_IMPORT);
+    StudentView v;
+    int have_data = data_view(&v);
+    *rejected = 0;
+    RollSet seen;
+    if (!rollset_init(&seen, have_data ? v.slots : 0)) return metric_end(&m, -1);
+    if (have_data) metric_count(MC_SCANNED, (uint64_t)v.slots);
+    for (int i = 0; have_data && i < v.slots; ++i)
+        if (!is_deleted(view_rec(&v, i))) rollset_add(&seen, view_rec(&v, i)->rollNo);
+
+    unsigned char *batch = malloc((size_t)IMPORT_BATCH * RECORD_SIZE);
+    if (!batch) { rollset_free(&seen); return metric_end(&m, -1); }
+    char line[1024];
+    int lineno = 0, pending = 0, imported = 0, ok = 1;
+    while (ok && fgets(line, sizeof(line), in)) {
+        lineno++;
+        metric_count(MC_BYTES_READ, strlen(line));
+        line[strcspn(line, "\r\n")] = '\0';
+        char *t = trim(line);
+        if (*t == '\0' || *t == '#') continue;
+        Student s;
+        const char *err = parse_import_line(t, &s);
+        if (!err && !rollset_add(&seen, s.rollNo)) err = "duplicate roll number";
+        if (err) {
+            fprintf(stderr, "line %d: %s\n", lineno, err);
+            (*rejected)++;
+            continue;
+        }
+        recalc_student(&s);
+        student_to_rec(&s, (StudentRec *)(batch + (size_t)pending * RECORD_SIZE));
+        if (++pending == IMPORT_BATCH) {
+            ok = append_records(batch, pending) >= 0;
+            imported += ok ? pending : 0;
+            pending = 0;
+        }
+    }
+    if (ok && pending > 0) {
+        ok = append_records(batch, pending) >= 0;
+        imported += ok ? pending : 0;
+    }
+    free(batch);
+    rollset_free(&seen);
+    if (imported > 0) indexes_rebuild_all();
+    return metric_end(&m, ok ? imported : -1);
+}
+
+void import_feature() {
+    printf("Format: roll|name");
+    for (int i = 0; i < SUBJECT_COUNT; ++i) printf("|%s", SUBJECT_NAMES[i]);
+    printf("\nEnter file to import: ");
+    char path[200];
+    safe_fgets(path, sizeof(path));
+    FILE *in = io_fopen(path, "r");
+    if (!in) { printf(COL_RED "Cannot open %s.\n" COL_RESET, path); pause_anykey(); return; }
+    int rejected;
+    int n = import_students(in, &rejected);
+    fclose(in);
+    if (n < 0) printf(COL_RED "Error writing data file.\n" COL_RESET);
+    else printf(COL_GREEN "Imported %d students (%d lines rejected).\n" COL_RESET, n, rejected);
+    pause_anykey();
+}
+
+// -------- DISPLAY (sorting & pagination) --------
+// Pointers to the live records of the current data view, in slot order.
+// Only the pointer array is allocated; the caller frees it.
+const StudentRec **live_students(int *count) {
+    *count = 0;
+    StudentView v;
+    if (!data_view(&v) || v.slots == 0) return NULL;
+    const StudentRec **arr = malloc(sizeof(*arr) * v.slots);
+    if (!arr) return NULL;
+    MetricScope m;
+    metric_begin(&m, MOP_LIST);
+    metric_count(MC_SCANNED, (uint64_t)v.slots);
+    int n = 0;
+    for (int i = 0; i < v.slots; ++i)
+        if (!is_deleted(view_rec(&v, i))) arr[n++] = view_rec(&v, i);
+    metric_end(&m, 0);
+    if (n == 0) { free(arr); return NULL; }
+    *count = n;
+    return arr;
+}
+
+// Table rows and headers go into the current frame; callers flush it.
+void print_student_row(const StudentRec *s) {
+    fb_printf("%-8d | %-25s |", s->rollNo, s->name);
+    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+        fb_printf(" %6.2f |", s->marks[i]);
+    }
+    fb_printf(" %7.2f | %6.2f |   %c\n", s->total, s->percentage, s->grade);
+}
+
+void display_table_header() {
+    fb_printf(COL_YELLOW "Roll     | Name                      |" COL_RESET);
+    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+        fb_printf(" %-6s |", SUBJECT_NAMES[i]);
+    }
+    fb_printf("  Total  |   Perc | Grade\n");
+    fb_printf("--------------------------------------------------------------------------------\n");
+}
+
+// Live records in one display order, read a page at a time: a walk over
+// one of the sorted indexes, or over the slots when unsorted.
+typedef struct {
+    int sorted;
+    BTree tree;
+    BtNode node;        // cached leaf; n = -1 when not loaded
+    BtCursor cur;       // tree position, or cur.pos = next slot
+} RecordWalk;
+
+void walk_seek(RecordWalk *w, BtCursor c) {
+    w->cur = c;
+    w->node.n = -1;
+}
+
+const StudentRec *walk_next(RecordWalk *w, const StudentView *v) {
+    if (w->sorted) {
+        const StudentRec *r = bt_next(&w->tree, &w->cur, &w->node, v);
+        if (r) metric_count(MC_SCANNED, 1);
+        return r;
+    }
+    while (w->cur.pos < v->slots) {
+        const StudentRec *r = view_rec(v, w->cur.pos++);
+        metric_count(MC_SCANNED, 1);
+        if (!is_deleted(r)) return r;
+    }
+    return NULL;
+}
+
+// Page through count records of w. Only the rows of the current page are
+// fetched; the walk position at the start of each visited page is kept
+// so paging back does not rescan.
+void paginate_and_display(RecordWalk *w, int count) {
+    if (count == 0) {
+        printf(COL_RED "No records to display.\n" COL_RESET);
+        pause_anykey();
+        return;
+    }
+    int pages = (count + RECORDS_PER_PAGE - 1) / RECORDS_PER_PAGE;
+    BtCursor *starts = malloc(sizeof(BtCursor) * pages);
+    if (!starts) return;
+    starts[0] = w->cur;
+    int known = 1, current = 0;
+    while (1) {
+        StudentView v;
+        if (!data_view(&v)) break;
+        walk_seek(w, starts[current]);
+        fb_clear();
+        fb_printf(COL_CYAN "----- All Student Records (Page %d of %d) -----\n" COL_RESET, current+1, pages);
+        display_table_header();
+        for (int i = 0; i < RECORDS_PER_PAGE; ++i) {
+            const StudentRec *r = walk_next(w, &v);
+            if (!r) break;
+            print_student_row(r);
+        }
+        if (current + 1 == known && known < pages) starts[known++] = w->cur;
+        fb_printf("--------------------------------------------------------------------------------\n");
+        fb_printf("n: next page, p: prev page, q: quit display\n");
+        fb_flush();
+        int ch = getchar();
+        if (ch == '\n') ch = getchar(); // handle previous newline
+        if (ch == 'n' || ch == 'N') {
+            if (current + 1 < pages) current++;
+        } else if (ch == 'p' || ch == 'P') {
+            if (current > 0) current--;
+        } else {
+            break;
+        }
+    }
+    free(starts);
+    while (getchar() != '\n'); // clear trailing
+}
+
+void displayAll_feature() {
+    int live, tombstones;
+    if (!index_counts(&live, &tombstones) || live == 0) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
+
+    printf("Sort by: 1) Roll 2) Name 3) Percentage(desc) 4) No sort\nEnter choice: ");
+    int choice;
+    if (scanf("%d", &choice) != 1) { choice = 4; }
+    while (getchar() != '\n');
+
+    static const int kinds[3] = { BT_ROLL, BT_NAME, BT_PERCENTAGE };
+    RecordWalk w;
+    memset(&w, 0, sizeof(w));
+    w.node.n = -1;
+    if (choice >= 1 && choice <= 3) {
+        if (!bt_open(kinds[choice - 1], &w.tree, 1)) { printf(COL_RED "Cannot open sort index.\n" COL_RESET); pause_anykey(); return; }
+        w.sorted = 1;
+        w.cur = bt_first(&w.tree);
+    }
+    paginate_and_display(&w, live);
+    bt_close(&w.tree);
+}
+
+// -------- SEARCH (by roll, name, grade) --------
+// Live record of roll in the current view, or NULL.
+const StudentRec *find_by_roll(int roll) {
+    MetricScope m;
+    metric_begin(&m, MOP_FIND_ROLL);
+    StudentView v;
+    int slot = index_lookup(roll);
+    int found = slot >= 0 && data_view(&v) && slot < v.slots;
+    metric_end(&m, 0);
+    return found ? view_rec(&v, slot) : NULL;
+}
+
+// Case-insensitive substring test of a record name against lowercased lq.
+int name_matches(const StudentRec *s, const char *lq) {
+    char nm[MAX_NAME_LEN];
+    strncpy(nm, s->name, sizeof(nm));
+    nm[sizeof(nm) - 1] = '\0';
+    for (int i = 0; nm[i]; ++i) nm[i] = tolower((unsigned char)nm[i]);
+    return strstr(nm, lq) != NULL;
+}
+
+// Append s to a growing result array. Returns 0 when out of memory.
+int push_match(const StudentRec ***out, int *n, int *cap, const StudentRec *s) {
+    if (*n == *cap) {
+        int grown_cap = *cap ? *cap * 2 : 64;
+        const StudentRec **grown = realloc(*out, sizeof(**out) * grown_cap);
+        if (!grown) return 0;
+        *out = grown;
+        *cap = grown_cap;
+    }
+    (*out)[(*n)++] = s;
+    return 1;
+}
+
+void lowercase_query(const char *q, char *lq, size_t len) {
+    snprintf(lq, len, "%s", q);
+    for (int i = 0; lq[i]; ++i) lq[i] = tolower((unsigned char)lq[i]);
+}
+
+// Per-part match lists of a parallel name scan.
+typedef struct {
+    const StudentView *v;
+    const int32_t *cand;        // slots to test, or NULL for every slot
+    const char *lq;
+    const StudentRec ***out;
+    int *count;
+} NameScan;
+
+void name_scan_part(void *arg, int part, int begin, int end) {
+    NameScan *ns = arg;
+    const StudentRec **out = NULL;
+    int n = 0, cap = 0;
+    for (int k = begin; k < end; ++k) {
+        int slot = ns->cand ? ns->cand[k] : k;
+        if (slot < 0 || slot >= ns->v->slots) continue;
+        const StudentRec *s = view_rec(ns->v, slot);
+        if (is_deleted(s) || !name_matches(s, ns->lq)) continue;
+        if (!push_match(&out, &n, &cap, s)) break;
+    }
+    ns->out[part] = out;
+    ns->count[part] = n;
+}
+
+// Live records whose name contains q (case-insensitive), in slot order.
+// Returns a malloc'd pointer array (NULL when nothing matches). Queries of
+// three or more characters only visit the slots the trigram index offers;
+// the slots (or candidates) are checked in parallel parts whose match
+// lists are joined in order.
+const StudentRec **find_by_name(const char *q, int *count) {
+    *count = 0;
+    StudentView v;
+    if (!data_view(&v) || v.slots == 0) return NULL;
+    MetricScope m;
+    metric_begin(&m, MOP_FIND_NAME);
+    char lq[200];
+    lowercase_query(q, lq, sizeof(lq));
+    int ncand;
+    int32_t *cand = tri_candidates(lq, &ncand);
+    if (ncand >= 0 && !data_view(&v)) { free(cand); metric_end(&m, 0); return NULL; } // rebuild may remap
+    int total = ncand >= 0 ? ncand : v.slots;
+    metric_count(MC_SCANNED, (uint64_t)total);
+    int parts = parallel_parts(total, SCAN_MIN_CHUNK);
+    NameScan ns = { &v, ncand >= 0 ? cand : NULL, lq, calloc(parts, sizeof(*ns.out)), calloc(parts, sizeof(int)) };
+    const StudentRec **out = NULL;
+    int n = 0;
+    if (ns.out && ns.count) {
+        parallel_for(total, parts, name_scan_part, &ns);
+        for (int p = 0; p < parts; ++p) n += ns.count[p];
+        out = n > 0 ? malloc(sizeof(*out) * n) : NULL;
+        n = 0;
+        for (int p = 0; p < parts; ++p) {
+            if (out) memcpy(out + n, ns.out[p], sizeof(*out) * ns.count[p]);
+            n += out ? ns.count[p] : 0;
+            free(ns.out[p]);
+        }
+    }
+    free(ns.out);
+    free(ns.count);
+    free(cand);
+    metric_end(&m, 0);
+    *count = n;
+    if (n == 0) { free(out); return NULL; }
+    return out;
+}
+
+// Live records whose grade is one of `grades` (e.g. "A" or "BC") and, when
+// name is not NULL, whose name contains it. Slot order, same contract as
+// find_by_name. The grade bitmaps pick the slots; a name of three or more
+// characters is intersected with its trigram candidates first.
+const StudentRec **find_by_grade(const char *grades, const char *name, int *count) {
+    *count = 0;
+    MetricScope m;
+    metric_begin(&m, MOP_FIND_GRADE);
+    int nwords;
+    uint64_t *filter = grade_filter(grades, &nwords);
+    StudentView v;
+    if (!filter || !data_view(&v)) { free(filter); metric_end(&m, 0); return NULL; }
+    char lq[200] = "";
+    if (name) lowercase_query(name, lq, sizeof(lq));
+    int ncand = -1;
+    int32_t *cand = lq[0] ? tri_candidates(lq, &ncand) : NULL;
+    if (ncand >= 0 && !data_view(&v)) { free(cand); free(filter); metric_end(&m, 0); return NULL; }
+    const StudentRec **out = NULL;
+    int n = 0, cap = 0;
+    uint64_t scanned = 0;
+    if (ncand >= 0) {
+        for (int k = 0; k < ncand; ++k) {
+            int slot = cand[k];
+            if (slot < 0 || slot >= v.slots || slot >= nwords * 64) continue;
+            if (!(filter[slot >> 6] >> (slot & 63) & 1)) continue;
+            const StudentRec *s = view_rec(&v, slot);
+            scanned++;
+            if (!is_deleted(s) && name_matches(s, lq) && !push_match(&out, &n, &cap, s)) break;
+        }
+    } else {
+        for (int i = 0; i < nwords; ++i) {
+            for (uint64_t w = filter[i]; w; w &= w - 1) {
+                int slot = i * 64 + ctz64(w);
+                if (slot >= v.slots) break;
+                const StudentRec *s = view_rec(&v, slot);
+                scanned++;
+                if (lq[0] && !name_matches(s, lq)) continue;
+                if (!push_match(&out, &n, &cap, s)) { i = nwords; break; }
+            }
+        }
+    }
+    free(cand);
+    free(filter);
+    metric_count(MC_SCANNED, scanned);
+    metric_end(&m, 0);
+    *count = n;
+    if (n == 0) { free(out); return NULL; }
+    return out;
+}
+
+void search_feature() {
+    printf("Search by: 1) Roll\n  2) Name\n  3) Grade\nEnter choice: ");
+    int c;
+    if (scanf("%d", &c) != 1) { while (getchar()!='\n'); printf("Invalid.\n"); pause_anykey(); return; }
+    while (getchar() != '\n');
+
+    StudentView v;
+    if (!data_view(&v)) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
+
+    int found = 0;
+    if (c == 1) {
+        printf("Enter roll to search: ");
+        int r;
+        if (scanf("%d", &r) != 1) { printf("Invalid.\n"); while (getchar()!='\n'); pause_anykey(); return; }
+        while (getchar() != '\n');
+        const StudentRec *s = find_by_roll(r);
+        if (s) {
+            fb_printf(COL_GREEN "Student found:\n" COL_RESET);
+            print_student_row(s);
+            found = 1;
+        }
+    } else if (c == 2 || c == 3) {
+        const StudentRec **matches;
+        if (c == 2) {
+            printf("Enter name or substring (case-insensitive): ");
+            char q[200];
+            safe_fgets(q, sizeof(q));
+            matches = find_by_name(q, &found);
+        } else {
+            printf("Enter grade(s) (A/B/C/D/F, e.g. A or AB): ");
+            char g[16];
+            safe_fgets(g, sizeof(g));
+            matches = find_by_grade(g, NULL, &found);
+        }
+        if (found) fb_printf(COL_GREEN "Matching students:\n" COL_RESET);
+        for (int i = 0; i < found; ++i) print_student_row(matches[i]);
+        free(matches);
+    } else {
+        printf("Invalid choice.\n");
+    }
+
+    if (!found) printf(COL_RED "No matching records found.\n" COL_RESET);
+    pause_anykey();
+}
+
+// -------- UPDATE --------
+// Recalculate s and overwrite the stored record with the same roll number.
+int update_student(Student *s) {
+    MetricScope m;
+    metric_begin(&m, MOP_UPDATE);
+    int slot = index_lookup(s->rollNo);
+    Student old;
+    if (slot < 0 || !read_slot(slot, &old)) return metric_end(&m, OP_NOT_FOUND);
+    recalc_student(s);
+    DataStamp before = data_stamp();
+    if (!write_slot(slot, s)) return metric_end(&m, OP_IO_ERROR);
+    indexes_on_update(slot, &old, s, before);
+    return metric_end(&m, OP_OK);
+}
+
+void update_feature() {
+    printf("Enter roll number to update: ");
+    int r;
+    if (scanf("%d", &r) != 1) { printf("Invalid input.\n"); while (getchar()!='\n'); pause_anykey(); return; }
+    while (getchar() != '\n');
+
+    int slot = index_lookup(r);
+    if (slot < 0) { printf(COL_RED "Roll number not found.\n" COL_RESET); pause_anykey(); return; }
+
+    Student s;
+    if (!read_slot(slot, &s)) { printf(COL_RED "Error reading record.\n" COL_RESET); pause_anykey(); return; }
+
+    printf("Current name: %s\n", s.name);
+    printf("Enter new name (leave blank to keep): ");
+    char newname[MAX_NAME_LEN];
+    safe_fgets(newname, sizeof(newname));
+    if (strlen(newname) > 0) { strncpy(s.name, newname, sizeof(s.name)); to_titlecase(s.name); }
+    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+        printf("Current marks for %s: %.2f\n", SUBJECT_NAMES[i], s.marks[i]);
+        printf("Enter new marks (or -1 to keep): ");
+        float m;
+        if (scanf("%f", &m) != 1) { while (getchar()!='\n'); printf("Invalid input, keeping old.\n"); continue; }
+        if (m >= 0.0f) s.marks[i] = m;
+    }
+    while (getchar() != '\n');
+
+    if (update_student(&s) != OP_OK) { printf(COL_RED "Error writing record.\n" COL_RESET); pause_anykey(); return; }
+    printf(COL_GREEN "Record updated.\n" COL_RESET);
+    pause_anykey();
+}
+
+// -------- DELETE & COMPACTION --------
+// Rewrite the live records of `old` into a fresh DATA_FILE laid out for the
+// current subject list, in one pass. Returns the number of slots dropped,
+// or -1 on error.
+int rewrite_data_file(const StudentView *old) {
+    MetricScope m;
+    metric_begin(&m, MOP_REWRITE);
+    FILE *temp = io_fopen("temp.dat", "wb");
+    if (!temp) return metric_end(&m, -1);
+    metric_count(MC_SCANNED, (uint64_t)old->slots);
+    uint32_t buf[MAX_RECORD_SIZE / sizeof(uint32_t)];
+    StudentRec *rec = (StudentRec *)buf;
+    int reclaimed = 0, ok = write_data_header(temp);
+    for (int slot = 0; ok && slot < old->slots; ++slot) {
+        const StudentRec *r = view_rec(old, slot);
+        if (is_deleted(r)) { reclaimed++; continue; }
+        if (old->subjects == SUBJECT_COUNT) {
+            ok = io_fwrite(r, RECORD_SIZE, 1, temp) == 1;
+        } else {
+            Student s;
+            rec_to_student(r, old->subjects, &s);
+            recalc_student(&s);
+            student_to_rec(&s, rec);
+            ok = io_fwrite(rec, RECORD_SIZE, 1, temp) == 1;
+        }
+    }
+    ok = sync_file(temp) && ok;
+    ok = (fclose(temp) == 0) && ok;
+    if (!ok) { remove("temp.dat"); return metric_end(&m, -1); }
+    data_view_invalidate();
+    if (replace_file("temp.dat", DATA_FILE) != 0) { remove("temp.dat"); return metric_end(&m, -1); }
+    metric_count(MC_REWRITES, 1);
+    log_reset();
+    indexes_rebuild_all();
+    return metric_end(&m, reclaimed);
+}
+
+// Rewrite DATA_FILE without tombstones in one pass. Returns the number of
+// slots reclaimed, or -1 on error.
+int compact_data_file() {
+    StudentView v;
+    if (!data_view(&v)) return 0;
+    return rewrite_data_file(&v);
+}
+
+// Switch to a new subject list, converting existing records (new subjects
+// start at 0 marks and totals are recalculated).
+int change_subjects(int count, char names[][SUBJECT_NAME_LEN]) {
+    StudentView old;
+    int have_data = data_view(&old);
+    SUBJECT_COUNT = count;
+    for (int i = 0; i < count; ++i) memcpy(SUBJECT_NAMES[i], names[i], SUBJECT_NAME_LEN);
+    set_record_layout();
+    save_subjects();
+    if (!have_data) return 1;
+    return rewrite_data_file(&old) >= 0;
+}
+
+// Compact once tombstones make up a large enough share of the file.
+// Returns the number of slots reclaimed (0 if it was not due).
+int maybe_auto_compact() {
+    int live, tombstones;
+    if (!index_counts(&live, &tombstones)) return 0;
+    if (tombstones < COMPACT_MIN_TOMBSTONES) return 0;
+    if (tombstones * COMPACT_TOMBSTONE_RATIO < live + tombstones) return 0;
+    int reclaimed = compact_data_file();
+    return reclaimed > 0 ? reclaimed : 0;
+}
+
+// Tombstone the record of roll, compacting the file when tombstones have
+// piled up. *compacted (if given) receives the slots that reclaimed.
+int delete_student(int roll, int *compacted) {
+    MetricScope m;
+    metric_begin(&m, MOP_DELETE);
+    int slot = index_lookup(roll);
+    Student s;
+    if (slot < 0 || !read_slot(slot, &s)) return metric_end(&m, OP_NOT_FOUND);
+    DataStamp before = data_stamp();
+    Student old = s;
+    s.grade = DELETED_GRADE;
+    if (!write_slot(slot, &s)) return metric_end(&m, OP_IO_ERROR);
+    indexes_on_delete(slot, &old, before);
+    int reclaimed = maybe_auto_compact();
+    if (compacted) *compacted = reclaimed;
+    return metric_end(&m, OP_OK);
+}
+
+void delete_feature() {
+    printf("Enter roll number to delete: ");
+    int r;
+    if (scanf("%d", &r) != 1) { printf("Invalid input.\n"); while (getchar()!='\n'); pause_anykey(); return; }
+    while (getchar() != '\n');
+
+    int reclaimed = 0;
+    int rc = delete_student(r, &reclaimed);
+    if (rc == OP_NOT_FOUND) { printf(COL_RED "Roll number not found.\n" COL_RESET); pause_anykey(); return; }
+    if (rc != OP_OK) { printf(COL_RED "Error writing record.\n" COL_RESET); pause_anykey(); return; }
+    printf(COL_GREEN "Record deleted for roll %d\n" COL_RESET, r);
+    if (reclaimed > 0) printf(COL_YELLOW "Auto-compacted data file (%d slots reclaimed).\n" COL_RESET, reclaimed);
+    pause_anykey();
+}
+
+void migrate_feature() {
+    char src[200], dst[200];
+    printf("Legacy file to convert: ");
+    safe_fgets(src, sizeof(src));
+    printf("Write converted file to: ");
+    safe_fgets(dst, sizeof(dst));
+    if (strlen(src) == 0 || strlen(dst) == 0) { printf(COL_RED "Aborting.\n" COL_RESET); pause_anykey(); return; }
+    if (strcmp(dst, DATA_FILE) == 0) data_view_invalidate();
+    int n = migrate_legacy_file(src, dst);
+    if (n < 0) printf(COL_RED "Migration failed.\n" COL_RESET);
+    else printf(COL_GREEN "Converted %d records using the current %d subjects.\n" COL_RESET, n, SUBJECT_COUNT);
+    if (n >= 0 && strcmp(dst, DATA_FILE) == 0) { log_reset(); indexes_rebuild_all(); }
+    pause_anykey();
+}
+
+void compact_feature() {
+    int live, tombstones;
+    if (!index_counts(&live, &tombstones)) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
+    printf("Live records: %d, deleted slots: %d\n", live, tombstones);
+    if (tombstones == 0) { printf("Nothing to compact.\n"); pause_anykey(); return; }
+    int reclaimed = compact_data_file();
+    if (reclaimed < 0) printf(COL_RED "Compaction failed.\n" COL_RESET);
+    else printf(COL_GREEN "Compaction complete, %d slots reclaimed.\n" COL_RESET, reclaimed);
+    pause_anykey();
+}
+
+void storage_feature() {
+    struct stat lt;
+    long log_size = stat(LOG_FILE, &lt) == 0 ? (long)lt.st_size : 0;
+    printf("Storage engine: %s", g_storage_log ? "log-structured" : "plain file");
+    if (g_storage_log) printf(" (%ld bytes of log since the last checkpoint)", log_size);
+    printf("\n1) Plain file  2) Log-structured  3) Checkpoint now  (other: cancel)\nEnter choice: ");
+    int ch;
+    if (scanf("%d", &ch) != 1) ch = 0;
+    while (getchar() != '\n');
+    int ok = 1;
+    if (ch == 1 || ch == 2) ok = storage_set_mode(ch == 2);
+    else if (ch == 3) ok = log_checkpoint();
+    else return;
+    if (ok) printf(COL_GREEN "Done. Engine: %s\n" COL_RESET, g_storage_log ? "log-structured" : "plain file");
+    else printf(COL_RED "Storage operation failed.\n" COL_RESET);
+}
+
+// -------- LZ COMPRESSION --------
+// A small LZ77 codec in the LZ4 mould (token byte of literal/match length
+// nibbles, 255-extended lengths, 16-bit offsets) for backups. Streams are
+// cut into LZ_BLOCK-sized blocks that compress independently, each with a
+// checksum of its raw bytes; a block that does not shrink is stored as is.
+#define LZ_MAGIC "SLZ1"
+#define LZ_BLOCK (64 * 1024)     // offsets stay within 16 bits
+#define LZ_HASH_BITS 13
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5       // the block tail is always literal
+#define LZ_STORED 0x80000000u    // packed_len flag: block kept uncompressed
+
+typedef struct {
+    char magic[4];               // LZ_MAGIC
+    uint32_t block_size;
+} LzStreamHeader;
+
+typedef struct {
+    uint32_t raw_len;            // 0 ends the stream
+    uint32_t packed_len;         // | LZ_STORED
+    uint32_t checksum;           // xxh32 of the raw bytes
+} LzBlockHeader;
+
+uint32_t load32(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+uint64_t load64(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+uint32_t rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+// xxHash32: a checksum fast enough not to dominate decompression.
+uint32_t xxh32(const void *data, size_t len, uint32_t seed) {
+    const uint32_t P1 = 2654435761u, P2 = 2246822519u, P3 = 3266489917u, P4 = 668265263u, P5 = 374761393u;
+    const unsigned char *p = data, *end = p + len;
+    uint32_t h;
+    if (len >= 16) {
+        uint32_t a = seed + P1 + P2, b = seed + P2, c = seed, d = seed - P1;
+        for (; p + 16 <= end; p += 16) {
+            a = rotl32(a + load32(p) * P2, 13) * P1;
+            b = rotl32(b + load32(p + 4) * P2, 13) * P1;
+            c = rotl32(c + load32(p + 8) * P2, 13) * P1;
+            d = rotl32(d + load32(p + 12) * P2, 13) * P1;
+        }
+        h = rotl32(a, 1) + rotl32(b, 7) + rotl32(c, 12) + rotl32(d, 18);
+    } else {
+        h = seed + P5;
+    }
+    h += (uint32_t)len;
+    for (; p + 4 <= end; p += 4) h = rotl32(h + load32(p) * P3, 17) * P4;
+    for (; p < end; ++p) h = rotl32(h + *p * P5, 11) * P1;
+    h ^= h >> 15; h *= P2; h ^= h >> 13; h *= P3; h ^= h >> 16;
+    return h;
+}
+
+unsigned char *lz_put_length(unsigned char *op, size_t len) {
+    for (; len >= 255; len -= 255) *op++ = 255;
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+// Compress n <= LZ_BLOCK bytes into dst. Returns the packed size, or 0 if
+// it would not fit in cap.
+size_t lz_compress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap) {
+    uint16_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+    const unsigned char *ip = src, *anchor = src, *end = src + n;
+    const unsigned char *match_limit = end - (n < LZ_LAST_LITERALS ? n : LZ_LAST_LITERALS);
+    const unsigned char *search_limit = n > LZ_LAST_LITERALS + LZ_MIN_MATCH ? end - LZ_LAST_LITERALS - LZ_MIN_MATCH : src;
+    unsigned char *op = dst, *oend = dst + cap;
+    while (ip < search_limit) {
+        uint32_t seq = load32(ip);
+        uint32_t h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+        const unsigned char *ref = src + table[h];
+        table[h] = (uint16_t)(ip - src);
+        if (ref >= ip || load32(ref) != seq) {
+            ip += 1 + ((ip - anchor) >> 6); // skip faster through incompressible runs
+            continue;
+        }
+        const unsigned char *mend = ip + LZ_MIN_MATCH, *r = ref + LZ_MIN_MATCH;
+        while (mend + 8 <= match_limit && load64(mend) == load64(r)) { mend += 8; r += 8; }
+        while (mend < match_limit && *mend == *r) { ++mend; ++r; }
+        size_t lit = (size_t)(ip - anchor), mlen = (size_t)(mend - ip) - LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1) return 0;
+        unsigned char *token = op++;
+        *token = (unsigned char)(((lit < 15 ? lit : 15) << 4) | (mlen < 15 ? mlen : 15));
+        if (lit >= 15) op = lz_put_length(op, lit - 15);
+        memcpy(op, anchor, lit);
+        op += lit;
+        size_t off = (size_t)(ip - ref);
+        *op++ = (unsigned char)off;
+        *op++ = (unsigned char)(off >> 8);
+        if (mlen >= 15) op = lz_put_length(op, mlen - 15);
+        ip = anchor = mend;
+    }
+    size_t lit = (size_t)(end - anchor);
+    if ((size_t)(oend - op) < 1 + lit / 255 + 1 + lit) return 0;
+    *op++ = (unsigned char)((lit < 15 ? lit : 15) << 4);
+    if (lit >= 15) op = lz_put_length(op, lit - 15);
+    memcpy(op, anchor, lit);
+    return (size_t)(op + lit - dst);
+}
+
+// Decompress one block into dst (cap bytes). Returns its raw size, or -1
+// for malformed input; never reads or writes out of bounds.
+long lz_decompress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap) {
+    const unsigned char *ip = src, *iend = src + n;
+    unsigned char *op = dst, *oend = dst + cap;
+    while (ip < iend) {
+        unsigned token = *ip++;
+        size_t lit = token >> 4, b;
+        if (lit == 15) do { if (ip >= iend) return -1; b = *ip++; lit += b; } while (b == 255);
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend) break; // the block ends on literals
+        if (iend - ip < 2) return -1;
+        size_t off = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (off == 0 || off > (size_t)(op - dst)) return -1;
+        size_t mlen = token & 15;
+        if (mlen == 15) do { if (ip >= iend) return -1; b = *ip++; mlen += b; } while (b == 255);
+        mlen += LZ_MIN_MATCH;
+        if (mlen > (size_t)(oend - op)) return -1;
+        const unsigned char *m = op - off;
+        if (off >= 8 && mlen + 8 <= (size_t)(oend - op)) {
+            for (size_t i = 0; i < mlen; i += 8) memcpy(op + i, m + i, 8); // may spill up to 7 bytes
+        } else {
+            for (size_t i = 0; i < mlen; ++i) op[i] = m[i];
+        }
+        op += mlen;
+    }
+    return (long)(op - dst);
+}
+
+int lz_is_stream(const char *path) {
+    char magic[4];
+    FILE *fp = io_fopen(path, "rb");
+    if (!fp) return 0;
+    int yes = io_fread(magic, 1, 4, fp) == 4 && memcmp(magic, LZ_MAGIC, 4) == 0;
+    fclose(fp);
+    return yes;
+}
+
+// Compress the file src into the stream dst. Returns 1 on success.
+int lz_pack_file(const char *src, const char *dst) {
+    FILE *in = io_fopen(src, "rb");
+    if (!in) return 0;
+    FILE *out = io_fopen(dst, "wb");
+    unsigned char *raw = malloc(LZ_BLOCK), *packed = malloc(LZ_BLOCK);
+    LzStreamHeader sh;
+    memcpy(sh.magic, LZ_MAGIC, 4);
+    sh.block_size = LZ_BLOCK;
+    int ok = out && raw && packed && io_fwrite(&sh, sizeof(sh), 1, out) == 1;
+    size_t r;
+    while (ok && (r = io_fread(raw, 1, LZ_BLOCK, in)) > 0) {
+        LzBlockHeader bh;
+        bh.raw_len = (uint32_t)r;
+        bh.checksum = xxh32(raw, r, 0);
+        size_t p = lz_compress(raw, r, packed, r - 1);
+        bh.packed_len = p ? (uint32_t)p : (uint32_t)r | LZ_STORED;
+        ok = io_fwrite(&bh, sizeof(bh), 1, out) == 1 && io_fwrite(p ? packed : raw, 1, p ? p : r, out) == (p ? p : r);
+    }
+    LzBlockHeader last = {0, 0, 0};
+    ok = ok && !ferror(in) && io_fwrite(&last, sizeof(last), 1, out) == 1 && sync_file(out);
+    free(raw);
+    free(packed);
+    fclose(in);
+    if (out) ok = (fclose(out) == 0) && ok;
+    return ok;
+}
+
+// Expand the stream src into dst, checking every block. Returns 1 if the
+// whole stream was intact.
+int lz_unpack_file(const char *src, const char *dst) {
+    FILE *in = io_fopen(src, "rb");
+    if (!in) return 0;
+    FILE *out = io_fopen(dst, "wb");
+    unsigned char *raw = malloc(LZ_BLOCK + 8), *packed = malloc(LZ_BLOCK); // slack for match spill
+    LzStreamHeader sh;
+    int ok = out && raw && packed && io_fread(&sh, sizeof(sh), 1, in) == 1 &&
+             memcmp(sh.magic, LZ_MAGIC, 4) == 0 && sh.block_size == LZ_BLOCK;
+    int done = 0;
+    while (ok && !done) {
+        LzBlockHeader bh;
+        ok = io_fread(&bh, sizeof(bh), 1, in) == 1;
+        if (!ok || bh.raw_len == 0) { done = ok; break; }
+        uint32_t plen = bh.packed_len & ~LZ_STORED;
+        ok = bh.raw_len <= LZ_BLOCK && plen <= LZ_BLOCK;
+        if (ok && (bh.packed_len & LZ_STORED)) ok = plen == bh.raw_len && io_fread(raw, 1, plen, in) == plen;
+        else if (ok) ok = io_fread(packed, 1, plen, in) == plen && lz_decompress(packed, plen, raw, bh.raw_len + 8) == (long)bh.raw_len;
+        ok = ok && xxh32(raw, bh.raw_len, 0) == bh.checksum && io_fwrite(raw, 1, bh.raw_len, out) == bh.raw_len;
+    }
+    ok = ok && done && sync_file(out);
+    free(raw);
+    free(packed);
+    fclose(in);
+    if (out) ok = (fclose(out) == 0) && ok;
+    if (!ok) remove(dst);
+    return ok;
+}
+
+// -------- BACKUP & RESTORE --------
+// A full backup is a copy of DATA_FILE made inside the kernel: a reflink
+// where the filesystem supports one, else copy_file_range or sendfile.
+// An incremental backup writes only the BACKUP_BLOCK-sized blocks that
+// changed since the previous link of the chain to <backup>.<n>; the text
+// manifest <backup>.man lists the links in order, and <backup>.sum keeps
+// one checksum per block of the newest state so finding the changed blocks
+// only has to read DATA_FILE. Restore copies the full backup and replays
+// the deltas on top.
+#define BACKUP_BLOCK 4096
+#define BACKUP_MAX_CHAIN 32    // an incremental past this starts a new chain
+#define BACKUP_PATH_LEN 512
+
+typedef struct {
+    char magic[4];       // "SDLT"
+    int32_t block_size;
+    int64_t size;        // size of the data file after this delta
+    int32_t blocks;      // changed blocks that follow: int64 index + data
+    uint32_t checksum;   // FNV-1a over the block checksums of the result
+} DeltaHeader;
+
+typedef struct {
+    char magic[4];       // "SSUM"
+    int32_t links;       // manifest links these sums describe
+    int64_t size;
+} SumHeader;
+
+typedef struct {
+    int links;                      // full backup + deltas
+    int manifest;                   // 0: a bare copy (older backups)
+    int64_t size[BACKUP_MAX_CHAIN]; // data size after each link
+} BackupChain;
+
+// Copy src to dst without moving the bytes through user space where the
+// platform allows it. Returns 1 on success.
+int copy_file(const char *src, const char *dst) {
+#ifdef _WIN32
+    struct stat st;
+    int ok = CopyFileA(src, dst, FALSE) != 0;
+    if (ok && stat(dst, &st) == 0) {
+        metric_count(MC_BYTES_READ, (uint64_t)st.st_size);
+        metric_count(MC_BYTES_WRITTEN, (uint64_t)st.st_size);
+    }
+    return ok;
+#else
+    int in = open(src, O_RDONLY);
+    if (in < 0) return 0;
+    struct stat st;
+    int out = fstat(in, &st) == 0 ? open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (out < 0) { close(in); return 0; }
+    off_t left = st.st_size;
+    int ok = 1;
+#ifdef __linux__
+    if (ioctl(out, FICLONE, in) == 0) left = 0;
+    int use_cfr = 1;
+    while (left > 0) {
+        ssize_t n = -1;
+        if (use_cfr) {
+            n = copy_file_range(in, NULL, out, NULL, (size_t)left, 0);
+            if (n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) { use_cfr = 0; continue; }
+        } else {
+            n = sendfile(out, in, NULL, (size_t)left);
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break; // error or unexpected end: finish with read/write
+        left -= n;
+    }
+#endif
+    char buf[1 << 16];
+    while (ok && left > 0) {
+        ssize_t n = read(in, buf, sizeof(buf));
+        if (n <= 0) { ok = 0; break; }
+        ok = write(out, buf, (size_t)n) == n;
+        left -= n;
+    }
+    ok = fsync(out) == 0 && ok;
+    close(in);
+    if (ok) { // clones and in-kernel copies included
+        metric_count(MC_BYTES_READ, (uint64_t)st.st_size);
+        metric_count(MC_BYTES_WRITTEN, (uint64_t)st.st_size);
+    }
+    return close(out) == 0 && ok;
+#endif
+}
+
+// One checksum per BACKUP_BLOCK of path, in *count. NULL if unreadable.
+uint32_t *block_sums(const char *path, int *count, int64_t *size) {
+    FILE *fp = io_fopen(path, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    int n = (int)((*size + BACKUP_BLOCK - 1) / BACKUP_BLOCK);
+    uint32_t *sums = malloc((size_t)(n ? n : 1) * sizeof(uint32_t));
+    char *buf = malloc(BACKUP_BLOCK * 16);
+    int i = 0;
+    size_t r;
+    while (sums && buf && i < n && (r = io_fread(buf, 1, BACKUP_BLOCK * 16, fp)) > 0)
+        for (size_t off = 0; off < r && i < n; off += BACKUP_BLOCK)
+            sums[i++] = fnv1a(2166136261u, buf + off, r - off < BACKUP_BLOCK ? r - off : BACKUP_BLOCK);
+    free(buf);
+    fclose(fp);
+    if (i != n) { free(sums); return NULL; }
+    *count = n;
+    return sums;
+}
+
+void backup_side_path(char *out, const char *path, const char *suffix) {
+    snprintf(out, BACKUP_PATH_LEN, "%s%s", path, suffix);
+}
+
+// Read <path>.man. A backup without a manifest is a chain of one link.
+int backup_chain_read(const char *path, BackupChain *c) {
+    char man[BACKUP_PATH_LEN], line[128];
+    memset(c, 0, sizeof(*c));
+    backup_side_path(man, path, ".man");
+    FILE *fp = io_fopen(man, "r");
+    if (!fp) {
+        struct stat st;
+        if (stat(path, &st) != 0) return 0;
+        c->links = 1;
+        c->size[0] = st.st_size;
+        return 1;
+    }
+    c->manifest = 1;
+    int block = 0;
+    if (!fgets(line, sizeof(line), fp) || sscanf(line, "SRMS-BACKUP 1 %d", &block) != 1 || block != BACKUP_BLOCK) {
+        fclose(fp);
+        return 0;
+    }
+    char kind[16];
+    long long size;
+    while (c->links < BACKUP_MAX_CHAIN && fgets(line, sizeof(line), fp) &&
+           sscanf(line, "%15s %lld", kind, &size) == 2 &&
+           strcmp(kind, c->links == 0 ? "full" : "delta") == 0)
+        c->size[c->links++] = size;
+    fclose(fp);
+    return c->links > 0;
+}
+
+// Append one link to the manifest (creating it for a full backup).
+int backup_chain_append(const char *path, int link, int64_t size) {
+    char man[BACKUP_PATH_LEN], file[BACKUP_PATH_LEN];
+    backup_side_path(man, path, ".man");
+    FILE *fp = io_fopen(man, link == 0 ? "w" : "a");
+    if (!fp) return 0;
+    if (link == 0) fprintf(fp, "SRMS-BACKUP 1 %d\n", BACKUP_BLOCK);
+    if (link == 0) snprintf(file, sizeof(file), "%s", path);
+    else snprintf(file, sizeof(file), "%s.%d", path, link);
+    fprintf(fp, "%s %lld %s\n", link == 0 ? "full" : "delta", (long long)size, file);
+    int ok = sync_file(fp);
+    return (fclose(fp) == 0) && ok;
+}
+
+int backup_sums_write(const char *path, int links, int64_t size, const uint32_t *sums, int n) {
+    char sum[BACKUP_PATH_LEN];
+    backup_side_path(sum, path, ".sum");
+    FILE *fp = io_fopen(sum, "wb");
+    if (!fp) return 0;
+    SumHeader h;
+    memcpy(h.magic, "SSUM", 4);
+    h.links = links;
+    h.size = size;
+    int ok = io_fwrite(&h, sizeof(h), 1, fp) == 1 && (n == 0 || io_fwrite(sums, sizeof(uint32_t), (size_t)n, fp) == (size_t)n);
+    return (fclose(fp) == 0) && ok;
+}
+
+// Block checksums of the newest state of the chain, or NULL when they are
+// missing or describe another chain.
+uint32_t *backup_sums_read(const char *path, const BackupChain *c, int *count) {
+    char sum[BACKUP_PATH_LEN];
+    backup_side_path(sum, path, ".sum");
+    FILE *fp = io_fopen(sum, "rb");
+    if (!fp) return NULL;
+    SumHeader h;
+    uint32_t *sums = NULL;
+    int n = 0;
+    if (io_fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, "SSUM", 4) == 0 &&
+        h.links == c->links && h.size == c->size[c->links - 1]) {
+        n = (int)((h.size + BACKUP_BLOCK - 1) / BACKUP_BLOCK);
+        sums = malloc((size_t)(n ? n : 1) * sizeof(uint32_t));
+        if (sums && io_fread(sums, sizeof(uint32_t), (size_t)n, fp) != (size_t)n) { free(sums); sums = NULL; }
+    }
+    fclose(fp);
+    *count = n;
+    return sums;
+}
+
+void backup_remove_chain(const char *path) {
+    BackupChain c;
+    char file[BACKUP_PATH_LEN];
+    if (backup_chain_read(path, &c))
+        for (int i = 1; i < c.links; ++i) { snprintf(file, sizeof(file), "%s.%d", path, i); remove(file); }
+    backup_side_path(file, path, ".sum"); remove(file);
+    backup_side_path(file, path, ".man"); remove(file);
+}
+
+// Full backup of DATA_FILE to path (after a checkpoint, with the log
+// engine), optionally as an LZ stream; starts a new chain.
+int backup_to(const char *path, int compress) {
+    MetricScope m;
+    metric_begin(&m, MOP_BACKUP);
+    if (!log_checkpoint()) return metric_end(&m, OP_IO_ERROR);
+    struct stat st;
+    if (stat(DATA_FILE, &st) != 0) return metric_end(&m, OP_NOT_FOUND);
+    backup_remove_chain(path);
+    if (!compress) {
+        if (!copy_file(DATA_FILE, path)) return metric_end(&m, OP_IO_ERROR);
+        return metric_end(&m, backup_chain_append(path, 0, st.st_size) ? OP_OK : OP_IO_ERROR);
+    }
+    // The block checksums cannot be taken from a packed copy later, so the
+    // first incremental gets them now.
+    int n;
+    int64_t size;
+    uint32_t *sums = block_sums(DATA_FILE, &n, &size);
+    int ok = sums && lz_pack_file(DATA_FILE, path) && backup_sums_write(path, 1, size, sums, n) &&
+             backup_chain_append(path, 0, size);
+    free(sums);
+    return metric_end(&m, ok ? OP_OK : OP_IO_ERROR);
+}
+
+// Incremental backup onto the chain at path: writes the changed blocks to
+// the next <path>.<n>. Falls back to a full backup when there is no usable
+// chain; *blocks gets the number of blocks written (-1 for a full backup).
+int backup_incremental(const char *path, int *blocks) {
+    MetricScope m;
+    metric_begin(&m, MOP_BACKUP_INCR);
+    BackupChain c;
+    *blocks = -1;
+    if (!backup_chain_read(path, &c) || c.links >= BACKUP_MAX_CHAIN) return metric_end(&m, backup_to(path, lz_is_stream(path)));
+    int nold;
+    int64_t old_size = c.size[c.links - 1];
+    uint32_t *old = backup_sums_read(path, &c, &nold);
+    if (!old && c.links == 1) old = block_sums(path, &nold, &old_size); // first delta after a full copy
+    if (!old || old_size != c.size[c.links - 1] || (!c.manifest && !backup_chain_append(path, 0, old_size))) {
+        free(old);
+        return metric_end(&m, backup_to(path, lz_is_stream(path)));
+    }
+    if (!log_checkpoint()) { free(old); return metric_end(&m, OP_IO_ERROR); }
+    int n;
+    int64_t size;
+    uint32_t *cur = block_sums(DATA_FILE, &n, &size);
+    if (!cur) { free(old); return metric_end(&m, OP_NOT_FOUND); }
+
+    DeltaHeader h;
+    memcpy(h.magic, "SDLT", 4);
+    h.block_size = BACKUP_BLOCK;
+    h.size = size;
+    h.blocks = 0;
+    h.checksum = fnv1a(2166136261u, cur, (size_t)n * sizeof(uint32_t));
+    for (int i = 0; i < n; ++i) h.blocks += i >= nold || cur[i] != old[i];
+    *blocks = h.blocks;
+    if (h.blocks == 0 && size == old_size) { free(old); free(cur); return metric_end(&m, OP_OK); } // nothing changed
+
+    char file[BACKUP_PATH_LEN];
+    snprintf(file, sizeof(file), "%s.%d", path, c.links);
+    FILE *in = io_fopen(DATA_FILE, "rb");
+    FILE *out = in ? io_fopen(file, "wb") : NULL;
+    int ok = out && io_fwrite(&h, sizeof(h), 1, out) == 1;
+    char buf[BACKUP_BLOCK];
+    for (int i = 0; ok && i < n; ++i) {
+        if (i < nold && cur[i] == old[i]) continue;
+        int64_t at = (int64_t)i * BACKUP_BLOCK;
+        size_t len = size - at < BACKUP_BLOCK ? (size_t)(size - at) : BACKUP_BLOCK;
+        memset(buf, 0, sizeof(buf));
+        ok = fseek(in, (long)at, SEEK_SET) == 0 && io_fread(buf, 1, len, in) == len &&
+             io_fwrite(&at, sizeof(at), 1, out) == 1 && io_fwrite(buf, 1, BACKUP_BLOCK, out) == BACKUP_BLOCK;
+    }
+    if (in) fclose(in);
+    if (out) { ok = sync_file(out) && ok; ok = (fclose(out) == 0) && ok; }
+    // The manifest line is the commit point: sums written first only look
+    // stale (and force a full backup) if we stop in between.
+    ok = ok && backup_sums_write(path, c.links + 1, size, cur, n) && backup_chain_append(path, c.links, size);
+    if (!ok) remove(file);
+    free(old);
+    free(cur);
+    return metric_end(&m, ok ? OP_OK : OP_IO_ERROR);
+}
+
+// Rebuild the data as of link upto (negative: the newest) of the chain at
+// path into out. Returns an OP code.
+int backup_replay(const char *path, int upto, const char *out) {
+    BackupChain c;
+    if (!backup_chain_read(path, &c)) return OP_NOT_FOUND;
+    if (upto < 0 || upto >= c.links) upto = c.links - 1;
+    if (!(lz_is_stream(path) ? lz_unpack_file(path, out) : copy_file(path, out))) return OP_IO_ERROR;
+    FILE *fp = io_fopen(out, "r+b");
+    if (!fp) return OP_IO_ERROR;
+    int ok = 1;
+    uint32_t checksum = 0;
+    char file[BACKUP_PATH_LEN], buf[BACKUP_BLOCK];
+    for (int link = 1; ok && link <= upto; ++link) {
+        snprintf(file, sizeof(file), "%s.%d", path, link);
+        FILE *d = io_fopen(file, "rb");
+        DeltaHeader h;
+        ok = d && io_fread(&h, sizeof(h), 1, d) == 1 && memcmp(h.magic, "SDLT", 4) == 0 &&
+             h.block_size == BACKUP_BLOCK && h.size == c.size[link];
+        for (int i = 0; ok && i < h.blocks; ++i) {
+            int64_t at;
+            ok = io_fread(&at, sizeof(at), 1, d) == 1 && io_fread(buf, 1, BACKUP_BLOCK, d) == BACKUP_BLOCK &&
+                 at >= 0 && at < h.size && fseek(fp, (long)at, SEEK_SET) == 0 &&
+                 io_fwrite(buf, 1, at + BACKUP_BLOCK > h.size ? (size_t)(h.size - at) : BACKUP_BLOCK, fp) > 0;
+        }
+        if (d) fclose(d);
+        checksum = ok ? h.checksum : 0;
+    }
+    ok = sync_file(fp) && ok;
+#ifdef _WIN32
+    ok = ok && _chsize_s(_fileno(fp), c.size[upto]) == 0;
+#else
+    ok = ok && ftruncate(fileno(fp), (off_t)c.size[upto]) == 0;
+#endif
+    ok = (fclose(fp) == 0) && ok;
+    if (ok && upto > 0) { // check the result against the checksums the delta was made from
+        int n;
+        int64_t size;
+        uint32_t *sums = block_sums(out, &n, &size);
+        ok = sums && fnv1a(2166136261u, sums, (size_t)n * sizeof(uint32_t)) == checksum;
+        free(sums);
+    }
+    if (!ok) remove(out);
+    return ok ? OP_OK : OP_IO_ERROR;
+}
+
+// Replace DATA_FILE with the state after link upto of the backup chain.
+int restore_from(const char *path, int upto) {
+    MetricScope m;
+    metric_begin(&m, MOP_RESTORE);
+    int rc = backup_replay(path, upto, "temp.dat");
+    if (rc != OP_OK) return metric_end(&m, rc);
+    data_view_invalidate();
+    if (replace_file("temp.dat", DATA_FILE) != 0) return metric_end(&m, OP_IO_ERROR); // DATA_FILE untouched; temp.dat kept
+    metric_count(MC_REWRITES, 1);
+    log_reset();
+    data_file_open_check(); // the backup may predate the versioned format
+    indexes_rebuild_all();
+    return metric_end(&m, OP_OK);
+}
+
+void backup_data() {
+    printf("1) Full backup  2) Incremental (changed blocks only)  3) Full, compressed\nEnter choice: ");
+    int ch, blocks = -1, rc;
+    if (scanf("%d", &ch) != 1) ch = 0;
+    while (getchar() != '\n');
+    if (ch == 2) rc = backup_incremental(BACKUP_FILE, &blocks);
+    else if (ch == 1 || ch == 3) rc = backup_to(BACKUP_FILE, ch == 3);
+    else return;
+    if (rc == OP_NOT_FOUND) { printf(COL_RED "No data to backup.\n" COL_RESET); pause_anykey(); return; }
+    if (rc != OP_OK) { printf(COL_RED "Cannot create backup file.\n" COL_RESET); pause_anykey(); return; }
+    if (blocks >= 0) printf(COL_GREEN "Incremental backup of %s: %d changed block(s).\n" COL_RESET, BACKUP_FILE, blocks);
+    else printf(COL_GREEN "Backup saved to %s\n" COL_RESET, BACKUP_FILE);
+    pause_anykey();
+}
+
+void restore_data() {
+    BackupChain c;
+    if (!backup_chain_read(BACKUP_FILE, &c)) { printf(COL_RED "Backup not found.\n" COL_RESET); pause_anykey(); return; }
+    int upto = c.links - 1;
+    if (c.links > 1) {
+        char line[32];
+        printf("Backup chain: full + %d incremental(s). Restore up to which (0-%d, Enter = latest)? ", c.links - 1, c.links - 1);
+        safe_fgets(line, sizeof(line));
+        if (line[0]) upto = atoi(line);
+    }
+    int rc = restore_from(BACKUP_FILE, upto);
+    if (rc == OP_NOT_FOUND) printf(COL_RED "Backup not found.\n" COL_RESET);
+    else if (rc != OP_OK) printf(COL_RED "Cannot restore (damaged backup or permission?).\n" COL_RESET);
+    else printf(COL_GREEN "Data restored from backup.\n" COL_RESET);
+    pause_anykey();
+}
+
+// -------- REPORT CARD GENERATION --------
+// Parts of a report card that do not depend on the student, formatted once
+// per batch: the subject labels and the generation time.
+typedef struct {
+    char subject_label[MAX_SUBJECTS][SUBJECT_NAME_LEN + 8];
+    char generated[64];
+} ReportTemplate;
+
+#define REPORT_MAX_LEN (512 + MAX_NAME_LEN + MAX_SUBJECTS * (SUBJECT_NAME_LEN + 40))
+
+void report_template_init(ReportTemplate *t) {
+    for (int i = 0; i < SUBJECT_COUNT; ++i)
+        snprintf(t->subject_label[i], sizeof(t->subject_label[i]), "%-12.*s : ", SUBJECT_NAME_LEN - 1, SUBJECT_NAMES[i]);
+    snprintf(t->generated, sizeof(t->generated), "Generated on: %s", ctime(&(time_t){time(NULL)}));
+}
+
+// Render the report card of s into buf (REPORT_MAX_LEN bytes). Returns
+// its length.
+int format_report(const ReportTemplate *t, const StudentRec *s, char *buf) {
+    int n = snprintf(buf, REPORT_MAX_LEN, "----- Report Card -----\nRoll Number: %d\nName: %.*s\n",
+                     s->rollNo, MAX_NAME_LEN, s->name);
+    for (int i = 0; i < SUBJECT_COUNT; ++i)
+        n += snprintf(buf + n, REPORT_MAX_LEN - n, "%s%.2f\n", t->subject_label[i], s->marks[i]);
+    n += snprintf(buf + n, REPORT_MAX_LEN - n, "Total       : %.2f\nPercentage  : %.2f\nGrade       : %c\n%s",
+                  s->total, s->percentage, s->grade, t->generated);
+    return n < REPORT_MAX_LEN ? n : REPORT_MAX_LEN - 1;
+}
+
+// Write a rendered report with one write; the file name goes to fname.
+int write_report_file(const StudentRec *s, const char *buf, int len, char *fname, size_t fname_len) {
+    snprintf(fname, fname_len, "%s/report_roll_%d.txt", REPORTS_DIR, s->rollNo);
+    FILE *rp = io_fopen(fname, "wb");
+    if (!rp) return OP_IO_ERROR;
+    int ok = io_fwrite(buf, 1, len, rp) == (size_t)len;
+    ok = (fclose(rp) == 0) && ok;
+    return ok ? OP_OK : OP_IO_ERROR;
+}
+
+// Write the report card of s; the file name goes to fname.
+int write_report(const StudentRec *s, char *fname, size_t fname_len) {
+    MetricScope m;
+    metric_begin(&m, MOP_REPORT);
+    ReportTemplate t;
+    char buf[REPORT_MAX_LEN];
+    ensure_reports_dir();
+    report_template_init(&t);
+    return metric_end(&m, write_report_file(s, buf, format_report(&t, s, buf), fname, fname_len));
+}
+
+// Which students a batch of reports covers.
+typedef struct {
+    char grades[8];     // grade letters, empty for all
+    int roll_min;
+    int roll_max;
+} ReportFilter;
+
+typedef struct {
+    const StudentView *v;
+    const ReportFilter *f;
+    const ReportTemplate *t;
+    const uint64_t *grade_bits; // NULL when not filtering by grade
+    int grade_words;
+    int *written;               // per part
+    int *failed;
+} ReportBatch;
+
+void report_batch_part(void *arg, int part, int begin, int end) {
+    ReportBatch *b = arg;
+    char buf[REPORT_MAX_LEN], fname[256];
+    int written = 0, failed = 0;
+    for (int slot = begin; slot < end; ++slot) {
+        if (b->grade_bits && (slot >= b->grade_words * 64 || !(b->grade_bits[slot >> 6] >> (slot & 63) & 1))) continue;
+        const StudentRec *s = view_rec(b->v, slot);
+        if (is_deleted(s) || s->rollNo < b->f->roll_min || s->rollNo > b->f->roll_max) continue;
+        if (write_report_file(s, buf, format_report(b->t, s, buf), fname, sizeof(fname)) == OP_OK) written++;
+        else failed++;
+    }
+    b->written[part] = written;
+    b->failed[part] = failed;
+}
+
+// Write report cards for every live student passing f, across the thread
+// pool. Returns the number written (-1 if there is no data); failures go
+// to *failed.
+int generate_reports(const ReportFilter *f, int *failed) {
+    *failed = 0;
+    StudentView v;
+    uint64_t *bits = NULL;
+    int words = 0;
+    if (f->grades[0] && !(bits = grade_filter(f->grades, &words))) return 0;
+    if (!data_view(&v)) { free(bits); return -1; }
+    MetricScope m;
+    metric_begin(&m, MOP_REPORTS);
+    metric_count(MC_SCANNED, (uint64_t)v.slots);
+    ensure_reports_dir();
+    ReportTemplate t;
+    report_template_init(&t);
+    int parts = parallel_parts(v.slots, 256);
+    ReportBatch b = { &v, f, &t, bits, words, calloc(parts, sizeof(int)), calloc(parts, sizeof(int)) };
+    int written = 0;
+    if (b.written && b.failed) {
+        parallel_for(v.slots, parts, report_batch_part, &b);
+        for (int p = 0; p < parts; ++p) { written += b.written[p]; *failed += b.failed[p]; }
+    }
+    free(b.written);
+    free(b.failed);
+    free(bits);
+    return metric_end(&m, written);
+}
+
+void generate_all_reports_feature() {
+    ReportFilter f = { "", INT32_MIN, INT32_MAX };
+    char line[64];
+    printf("Grades to include (e.g. AB, blank for all): ");
+    safe_fgets(line, sizeof(line));
+    snprintf(f.grades, sizeof(f.grades), "%.7s", line);
+    printf("Lowest roll number (blank for none): ");
+    safe_fgets(line, sizeof(line));
+    if (line[0]) f.roll_min = atoi(line);
+    printf("Highest roll number (blank for none): ");
+    safe_fgets(line, sizeof(line));
+    if (line[0]) f.roll_max = atoi(line);
+    int failed;
+    int n = generate_reports(&f, &failed);
+    if (n < 0) printf(COL_RED "No records found.\n" COL_RESET);
+    else printf(COL_GREEN "%d report cards written to %s/" COL_RESET "%s\n", n, REPORTS_DIR,
+                failed ? " (some could not be written)" : "");
+    pause_anykey();
+}
+
+void generate_report(int roll) {
+    const StudentRec *s = find_by_roll(roll);
+    if (!s) { printf(COL_RED "Student not found.\n" COL_RESET); pause_anykey(); return; }
+    char fname[256];
+    if (write_report(s, fname, sizeof(fname)) != OP_OK) { printf(COL_RED "Cannot create report file.\n" COL_RESET); pause_anykey(); return; }
+    printf(COL_GREEN "Report generated: %s\n" COL_RESET, fname);
+    pause_anykey();
+}
+
+void generate_report_for_student_feature() {
+    printf("Enter roll number to generate report: ");
+    int r;
+    if (scanf("%d", &r) != 1) { printf("Invalid input.\n"); while (getchar()!='\n'); pause_anykey(); return; }
+    while (getchar() != '\n');
+    generate_report(r);
+}
+
+// -------- COLUMNAR STORE & SIMD KERNELS --------
+// Structure-of-arrays copy of the live records, holding only what the
+// aggregations need: one float column per subject plus percentage, grade,
+// roll and slot (to fetch names of toppers). Built once per data view and
+// cached until DATA_FILE changes.
+typedef struct {
+    int count;
+    int subjects;
+    unsigned generation;    // g_view_generation it was built from
+    int32_t *roll;
+    int32_t *slot;
+    float *percentage;
+    char *grade;
+    float *marks[MAX_SUBJECTS];
+} ColumnStore;
+
+ColumnStore g_cols;
+
+void columns_free(ColumnStore *c) {
+    free(c->roll); free(c->slot); free(c->percentage); free(c->grade);
+    for (int j = 0; j < MAX_SUBJECTS; ++j) free(c->marks[j]);
+    memset(c, 0, sizeof(*c));
+}
+
+typedef struct {
+    const StudentView *v;
+    ColumnStore *c;
+    int *offset;        // per part: live records before it (pass 1: count)
+} ColumnBuild;
+
+void columns_count_part(void *arg, int part, int begin, int end) {
+    ColumnBuild *b = arg;
+    int live = 0;
+    for (int i = begin; i < end; ++i) live += !is_deleted(view_rec(b->v, i));
+    b->offset[part] = live;
+}
+
+void columns_fill_part(void *arg, int part, int begin, int end) {
+    ColumnBuild *b = arg;
+    ColumnStore *c = b->c;
+    int k = b->offset[part];
+    for (int i = begin; i < end; ++i) {
+        const StudentRec *r = view_rec(b->v, i);
+        if (is_deleted(r)) continue;
+        c->roll[k] = r->rollNo;
+        c->slot[k] = i;
+        c->percentage[k] = r->percentage;
+        c->grade[k] = r->grade;
+        for (int j = 0; j < b->v->subjects; ++j) c->marks[j][k] = r->marks[j];
+        k++;
+    }
+}
+
+// Columns for the current data view, or NULL if there are no live records.
+// Built in two parallel passes: count the live records of each part, then
+// fill every part at its offset.
+const ColumnStore *columns_get() {
+    StudentView v;
+    if (!data_view(&v)) { columns_free(&g_cols); return NULL; }
+    if (g_cols.roll && g_cols.generation == g_view_generation) return &g_cols;
+    columns_free(&g_cols);
+    MetricScope m;
+    metric_begin(&m, MOP_COLUMNS);
+    int n = v.slots > 0 ? v.slots : 1;
+    ColumnStore *c = &g_cols;
+    c->roll = malloc(sizeof(int32_t) * n);
+    c->slot = malloc(sizeof(int32_t) * n);
+    c->percentage = malloc(sizeof(float) * n);
+    c->grade = malloc(n);
+    int ok = c->roll && c->slot && c->percentage && c->grade;
+    for (int j = 0; j < v.subjects; ++j) ok = (c->marks[j] = malloc(sizeof(float) * n)) && ok;
+    int parts = parallel_parts(v.slots, SCAN_MIN_CHUNK);
+    ColumnBuild b = { &v, c, malloc(sizeof(int) * parts) };
+    if (!ok || !b.offset) { free(b.offset); columns_free(c); metric_end(&m, 0); return NULL; }
+    metric_count(MC_SCANNED, (uint64_t)v.slots);
+    parallel_for(v.slots, parts, columns_count_part, &b);
+    int k = 0;
+    for (int p = 0; p < parts; ++p) { int live = b.offset[p]; b.offset[p] = k; k += live; }
+    parallel_for(v.slots, parts, columns_fill_part, &b);
+    free(b.offset);
+    c->count = k;
+    c->subjects = v.subjects;
+    c->generation = g_view_generation;
+    metric_end(&m, 0);
+    if (k == 0) { columns_free(c); return NULL; }
+    return c;
+}
+
+// Sum of a float column, accumulated in double precision.
+double col_sum(const float *x, int n) {
+    int i = 0;
+    double sum = 0.0;
+#ifdef HAVE_SSE2
+    __m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        lo = _mm_add_pd(lo, _mm_cvtps_pd(v));
+        hi = _mm_add_pd(hi, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    double part[2];
+    _mm_storeu_pd(part, _mm_add_pd(lo, hi));
+    sum = part[0] + part[1];
+#endif
+    for (; i < n; ++i) sum += x[i];
+    return sum;
+}
+
+// Index of the first maximum (want_max) or minimum of a column; -1 if empty.
+int col_argext(const float *x, int n, int want_max) {
+    if (n <= 0) return -1;
+    int i = 0;
+    float best = x[0];
+#ifdef HAVE_SSE2
+    if (n >= 4) {
+        __m128 acc = _mm_loadu_ps(x);
+        for (i = 4; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(x + i);
+            acc = want_max ? _mm_max_ps(acc, v) : _mm_min_ps(acc, v);
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, acc);
+        best = lanes[0];
+        for (int k = 1; k < 4; ++k)
+            if (want_max ? lanes[k] > best : lanes[k] < best) best = lanes[k];
+    }
+#endif
+    for (; i < n; ++i)
+        if (want_max ? x[i] > best : x[i] < best) best = x[i];
+    for (i = 0; i < n; ++i)
+        if (x[i] == best) return i;
+    return 0;
+}
+
+// counts[0..4] = A, B, C, D, everything else.
+void col_grade_counts(const char *g, int n, int counts[5]) {
+    static const char letters[4] = { 'A', 'B', 'C', 'D' };
+    int i = 0;
+    for (int k = 0; k < 5; ++k) counts[k] = 0;
+#ifdef HAVE_SSE2
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(g + i));
+        for (int k = 0; k < 4; ++k) {
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(letters[k])));
+            while (mask) { counts[k]++; mask &= mask - 1; }
+        }
+    }
+#endif
+    for (; i < n; ++i)
+        for (int k = 0; k < 4; ++k)
+            if (g[i] == letters[k]) { counts[k]++; break; }
+    counts[4] = n - counts[0] - counts[1] - counts[2] - counts[3];
+}
+
+// Everything the analytics need from the columns, as positions into them.
+typedef struct {
+    double sum_percentage;
+    double subj_sum[MAX_SUBJECTS];
+    int highest, lowest;
+    int subj_top[MAX_SUBJECTS];
+    int grade_counts[5];
+} ColumnReduction;
+
+typedef struct {
+    const ColumnStore *c;
+    ColumnReduction *parts;
+} ColumnReduceJob;
+
+void columns_reduce_part(void *arg, int part, int begin, int end) {
+    ColumnReduceJob *job = arg;
+    const ColumnStore *c = job->c;
+    ColumnReduction *r = &job->parts[part];
+    int n = end - begin;
+    memset(r, 0, sizeof(*r));
+    r->highest = r->lowest = -1;
+    if (n <= 0) return;
+    r->sum_percentage = col_sum(c->percentage + begin, n);
+    r->highest = begin + col_argext(c->percentage + begin, n, 1);
+    r->lowest = begin + col_argext(c->percentage + begin, n, 0);
+    for (int j = 0; j < c->subjects; ++j) {
+        r->subj_sum[j] = col_sum(c->marks[j] + begin, n);
+        r->subj_top[j] = begin + col_argext(c->marks[j] + begin, n, 1);
+    }
+    col_grade_counts(c->grade + begin, n, r->grade_counts);
+}
+
+// Reduce the columns with one SIMD pass per part across the thread pool,
+// then merge the parts in order (ties keep the earlier record, as the
+// serial kernels do). Returns 0 if out of memory.
+int columns_reduce(const ColumnStore *c, ColumnReduction *out) {
+    int parts = parallel_parts(c->count, SCAN_MIN_CHUNK);
+    ColumnReduceJob job = { c, malloc(sizeof(ColumnReduction) * parts) };
+    if (!job.parts) return 0;
+    parallel_for(c->count, parts, columns_reduce_part, &job);
+    *out = job.parts[0];
+    for (int p = 1; p < parts; ++p) {
+        const ColumnReduction *r = &job.parts[p];
+        if (r->highest < 0) continue;
+        out->sum_percentage += r->sum_percentage;
+        if (c->percentage[r->highest] > c->percentage[out->highest]) out->highest = r->highest;
+        if (c->percentage[r->lowest] < c->percentage[out->lowest]) out->lowest = r->lowest;
+        for (int j = 0; j < c->subjects; ++j) {
+            out->subj_sum[j] += r->subj_sum[j];
+            if (c->marks[j][r->subj_top[j]] > c->marks[j][out->subj_top[j]]) out->subj_top[j] = r->subj_top[j];
+        }
+        for (int k = 0; k < 5; ++k) out->grade_counts[k] += r->grade_counts[k];
+    }
+    free(job.parts);
+    return 1;
+}
+
+// -------- DISTRIBUTION STATISTICS --------
+// Median, quartiles, deciles, standard deviation and a histogram of the
+// overall percentage and of each subject.
+// - Exact figures come from the columns by introselect: quickselect with
+//   median-of-3 pivots that falls back to heapsort when partitions stop
+//   shrinking. It runs on a scratch copy, one column per pool part.
+// - Past DIST_EXACT_MAX records, or on request, KLL quantile sketches are
+//   used instead (SKETCH_FILE). They take O(K log n) space, keep ranks
+//   within ~1.7% of exact and merge across partitions.
+// A sketch cannot forget a value. Appended slots are folded in on the
+// next read; updates and deletes drop the file, which is rebuilt from one
+// parallel scan.
+#define DIST_BINS 10                 // histogram bins of width 10 over 0..100
+#define DIST_QUANTILES 11
+#define DIST_COLUMNS (MAX_SUBJECTS + 1) // percentage, then the subjects
+#define DIST_EXACT_MAX 4000000       // more live records use the sketches
+#define KLL_K 200                    // capacity of the top level
+#define KLL_MAX_LEVELS 40
+
+const double DIST_Q[DIST_QUANTILES] = { 0.10, 0.20, 0.25, 0.30, 0.40, 0.50, 0.60, 0.70, 0.75, 0.80, 0.90 };
+const char *const DIST_Q_NAMES[DIST_QUANTILES] = { "p10", "p20", "p25", "p30", "p40", "p50", "p60", "p70", "p75", "p80", "p90" };
+
+typedef struct {
+    int64_t count;
+    double mean, stddev;            // population standard deviation
+    float min, max;
+    float q[DIST_QUANTILES];        // at DIST_Q
+    int64_t hist[DIST_BINS];        // [0,10), [10,20), ..., [90,100]
+} Distribution;
+
+int dist_bin(float v) {
+    int b = (int)(v / 10.0f);
+    return b < 0 ? 0 : b >= DIST_BINS ? DIST_BINS - 1 : b;
+}
+
+void float_swap(float *a, int i, int j) {
+    float t = a[i]; a[i] = a[j]; a[j] = t;
+}
+
+void float_sift_down(float *a, int n, int i) {
+    while (1) {
+        int big = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && a[l] > a[big]) big = l;
+        if (r < n && a[r] > a[big]) big = r;
+        if (big == i) return;
+        float_swap(a, i, big);
+        i = big;
+    }
+}
+
+void float_heapsort(float *a, int n) {
+    for (int i = n / 2 - 1; i >= 0; --i) float_sift_down(a, n, i);
+    for (int end = n - 1; end > 0; --end) {
+        float_swap(a, 0, end);
+        float_sift_down(a, end, 0);
+    }
+}
+
+// Rearrange a[lo..hi] so that a[k] holds the value of rank k, with nothing
+// larger before it and nothing smaller after it.
+void introselect(float *a, int lo, int hi, int k) {
+    int budget = 0;
+    for (int n = hi - lo + 1; n > 1; n >>= 1) budget += 2;
+    while (hi > lo) {
+        if (budget-- == 0) { float_heapsort(a + lo, hi - lo + 1); return; }
+        int mid = lo + (hi - lo) / 2;
+        if (a[mid] < a[lo]) float_swap(a, lo, mid);
+        if (a[hi] < a[lo]) float_swap(a, lo, hi);
+        if (a[hi] < a[mid]) float_swap(a, mid, hi);
+        float pivot = a[mid];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (a[i] < pivot) i++;
+            while (a[j] > pivot) j--;
+            if (i <= j) { float_swap(a, i, j); i++; j--; }
+        }
+        if (k <= j) hi = j;          // [lo..j] <= pivot <= [i..hi], (j..i) == pivot
+        else if (k >= i) lo = i;
+        else return;
+    }
+}
+
+// Quantiles at DIST_Q of x[0..n), which is reordered: linear interpolation
+// between the values of rank floor((n-1)q) and the next one. Each
+// selection only searches the part right of the previous one.
+void exact_quantiles(float *x, int n, float *q) {
+    int lo = 0;
+    for (int i = 0; i < DIST_QUANTILES; ++i) {
+        double h = (n - 1) * DIST_Q[i];
+        int k = (int)h;
+        if (k >= lo) { introselect(x, lo, n - 1, k); lo = k + 1; }
+        double v = x[k];
+        if (h > k && k + 1 < n) {
+            if (k + 1 >= lo) { // the next rank is the minimum of what is left
+                int m = lo;
+                for (int t = lo + 1; t < n; ++t) if (x[t] < x[m]) m = t;
+                float_swap(x, lo, m);
+                lo = k + 2;
+            }
+            v += (h - k) * (x[k + 1] - x[k]);
+        }
+        q[i] = (float)v;
+    }
+}
+
+// Square root by Newton's method from above (no libm needed).
+double dist_sqrt(double x) {
+    if (x <= 0) return 0.0;
+    double r = x > 1 ? x : 1;
+    for (int i = 0; i < 100; ++i) {
+        double next = 0.5 * (r + x / r);
+        if (next >= r) break;
+        r = next;
+    }
+    return r;
+}
+
+// Sum of squared deviations from mean, in double precision.
+double col_sum_sq_dev(const float *x, int n, double mean) {
+    int i = 0;
+    double sum = 0.0;
+#ifdef HAVE_SSE2
+    __m128d m = _mm_set1_pd(mean), lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(x + i);
+        __m128d a = _mm_sub_pd(_mm_cvtps_pd(v), m), b = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), m);
+        lo = _mm_add_pd(lo, _mm_mul_pd(a, a));
+        hi = _mm_add_pd(hi, _mm_mul_pd(b, b));
+    }
+    double part[2];
+    _mm_storeu_pd(part, _mm_add_pd(lo, hi));
+    sum = part[0] + part[1];
+#endif
+    for (; i < n; ++i) sum += (x[i] - mean) * (x[i] - mean);
+    return sum;
+}
+
+// Exact distribution of x[0..n) (n > 0); scratch is reordered.
+void dist_exact(const float *x, float *scratch, int n, Distribution *d) {
+    memset(d, 0, sizeof(*d));
+    d->count = n;
+    d->mean = col_sum(x, n) / n;
+    d->stddev = dist_sqrt(col_sum_sq_dev(x, n, d->mean) / n);
+    d->min = d->max = x[0];
+    for (int i = 0; i < n; ++i) {
+        if (x[i] < d->min) d->min = x[i];
+        if (x[i] > d->max) d->max = x[i];
+        d->hist[dist_bin(x[i])]++;
+    }
+    memcpy(scratch, x, sizeof(float) * n);
+    exact_quantiles(scratch, n, d->q);
+}
+
+const float *dist_column(const ColumnStore *c, int col) {
+    return col == 0 ? c->percentage : c->marks[col - 1];
+}
+
+typedef struct {
+    const ColumnStore *c;
+    Distribution *out;
+} DistJob;
+
+void dist_exact_part(void *arg, int part, int begin, int end) {
+    DistJob *job = arg;
+    (void)part;
+    float *scratch = malloc(sizeof(float) * job->c->count);
+    for (int col = begin; col < end; ++col) {
+        if (scratch) dist_exact(dist_column(job->c, col), scratch, job->c->count, &job->out[col]);
+        else job->out[col].count = -1;
+    }
+    free(scratch);
+}
+
+// Exact distributions of all columns. Returns the number of columns, 0 if
+// there are no records, -1 if out of memory.
+int distribution_exact(Distribution *out) {
+    const ColumnStore *c = columns_get();
+    if (!c) return 0;
+    int ncols = c->subjects + 1;
+    DistJob job = { c, out };
+    parallel_for(ncols, c->count >= SCAN_MIN_CHUNK ? parallel_parts(ncols, 1) : 1, dist_exact_part, &job);
+    for (int col = 0; col < ncols; ++col) if (out[col].count < 0) return -1;
+    return ncols;
+}
+
+// KLL sketch: level h holds items of weight 2^h. When the items outgrow
+// the capacity (K at the top level, 2/3 of the level above below it), the
+// lowest full level is sorted and every other item, from a random start,
+// moves up a level.
+typedef struct {
+    int64_t n;
+    double sum, sumsq;              // exact, for mean and standard deviation
+    float min, max;
+    int levels;
+    int total, capacity;            // items held; sum of the level capacities
+    int size[KLL_MAX_LEVELS];
+    int alloc[KLL_MAX_LEVELS];
+    float *items[KLL_MAX_LEVELS];
+    uint64_t rng;
+    int failed;                     // out of memory: contents are incomplete
+} KllSketch;
+
+int kll_level_capacity(const KllSketch *s, int h) {
+    int c = KLL_K;
+    for (int i = s->levels - 1; i > h; --i) c = (c * 2 + 2) / 3;
+    return c < 2 ? 2 : c;
+}
+
+void kll_set_levels(KllSketch *s, int levels) {
+    s->levels = levels;
+    s->capacity = 0;
+    for (int h = 0; h < levels; ++h) s->capacity += kll_level_capacity(s, h);
+}
+
+void kll_init(KllSketch *s, uint64_t seed) {
+    memset(s, 0, sizeof(*s));
+    s->rng = seed;
+    kll_set_levels(s, 1);
+}
+
+void kll_free(KllSketch *s) {
+    for (int h = 0; h < KLL_MAX_LEVELS; ++h) free(s->items[h]);
+    memset(s, 0, sizeof(*s));
+}
+
+int kll_push(KllSketch *s, int h, float x) {
+    if (s->size[h] == s->alloc[h]) {
+        int grown = s->alloc[h] ? s->alloc[h] * 2 : 16;
+        float *p = realloc(s->items[h], sizeof(float) * grown);
+        if (!p) { s->failed = 1; return 0; }
+        s->items[h] = p;
+        s->alloc[h] = grown;
+    }
+    s->items[h][s->size[h]++] = x;
+    s->total++;
+    return 1;
+}
+
+int compare_float(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Halve the lowest full level into the one above.
+int kll_compact(KllSketch *s) {
+    int h = 0;
+    while (h < s->levels - 1 && s->size[h] < kll_level_capacity(s, h)) h++;
+    if (h == s->levels - 1) {
+        if (s->levels == KLL_MAX_LEVELS) { s->failed = 1; return 0; }
+        kll_set_levels(s, s->levels + 1);
+    }
+    float *a = s->items[h];
+    int n = s->size[h], keep = n & 1; // an odd item out stays behind
+    qsort(a, n, sizeof(float), compare_float);
+    for (int i = keep + (int)(splitmix64(&s->rng) & 1); i < n; i += 2)
+        if (!kll_push(s, h + 1, a[i])) return 0;
+    s->total -= n - keep;
+    s->size[h] = keep;
+    return 1;
+}
+
+int kll_settle(KllSketch *s) {
+    while (s->total > s->capacity)
+        if (!kll_compact(s)) return 0;
+    return 1;
+}
+
+void kll_add(KllSketch *s, float x) {
+    if (s->n == 0 || x < s->min) s->min = x;
+    if (s->n == 0 || x > s->max) s->max = x;
+    s->n++;
+    s->sum += x;
+    s->sumsq += (double)x * x;
+    if (kll_push(s, 0, x)) kll_settle(s);
+}
+
+// Fold src into dst, as if dst had seen src's values too.
+void kll_merge(KllSketch *dst, const KllSketch *src) {
+    dst->failed |= src->failed;
+    if (src->n == 0) return;
+    if (dst->n == 0 || src->min < dst->min) dst->min = src->min;
+    if (dst->n == 0 || src->max > dst->max) dst->max = src->max;
+    dst->n += src->n;
+    dst->sum += src->sum;
+    dst->sumsq += src->sumsq;
+    if (src->levels > dst->levels) kll_set_levels(dst, src->levels);
+    for (int h = 0; h < src->levels; ++h)
+        for (int i = 0; i < src->size[h]; ++i)
+            if (!kll_push(dst, h, src->items[h][i])) return;
+    kll_settle(dst);
+}
+
+float float_from_order_bits(uint32_t k) {
+    uint32_t u = (k & 0x80000000u) ? (k & 0x7fffffffu) : ~k;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Approximate distribution from a sketch: walk its items in value order,
+// each counting for its weight (compaction keeps the weights summing to n).
+int kll_distribution(const KllSketch *s, Distribution *d) {
+    memset(d, 0, sizeof(*d));
+    if (s->n == 0 || s->failed) return 0;
+    SortKey *keys = malloc(sizeof(SortKey) * (s->total > 0 ? s->total : 1));
+    if (!keys) return 0;
+    int m = 0;
+    for (int h = 0; h < s->levels; ++h)
+        for (int i = 0; i < s->size[h]; ++i) {
+            keys[m].key = float_order_bits(s->items[h][i]);
+            keys[m++].idx = h;
+        }
+    if (!sort_keys(keys, m, NULL, NULL, 1)) { free(keys); return 0; }
+    d->count = s->n;
+    d->mean = s->sum / s->n;
+    double var = s->sumsq / s->n - d->mean * d->mean;
+    d->stddev = dist_sqrt(var);
+    d->min = s->min;
+    d->max = s->max;
+    int64_t seen = 0;
+    int qi = 0;
+    for (int i = 0; i < m; ++i) {
+        float v = float_from_order_bits((uint32_t)keys[i].key);
+        int64_t w = (int64_t)1 << keys[i].idx;
+        d->hist[dist_bin(v)] += w;
+        seen += w;
+        while (qi < DIST_QUANTILES && seen >= DIST_Q[qi] * s->n) d->q[qi++] = v;
+    }
+    while (qi < DIST_QUANTILES) d->q[qi++] = s->max;
+    free(keys);
+    return 1;
+}
+
+typedef struct {
+    char magic[4];                  // "SQSK"
+    int32_t version;
+    int32_t subjects;
+    int32_t record_size;
+    int32_t columns;
+    int32_t slots;                  // DATA_FILE slots folded in
+    DataStamp data;                 // DATA_FILE stamp the slots were read at
+} SketchHeader;
+
+int kll_write(FILE *fp, const KllSketch *s) {
+    int ok = io_fwrite(&s->n, sizeof(s->n), 1, fp) == 1 && io_fwrite(&s->sum, sizeof(s->sum), 1, fp) == 1 &&
+             io_fwrite(&s->sumsq, sizeof(s->sumsq), 1, fp) == 1 && io_fwrite(&s->min, sizeof(s->min), 1, fp) == 1 &&
+             io_fwrite(&s->max, sizeof(s->max), 1, fp) == 1 && io_fwrite(&s->rng, sizeof(s->rng), 1, fp) == 1 &&
+             io_fwrite(&s->levels, sizeof(s->levels), 1, fp) == 1 &&
+             io_fwrite(s->size, sizeof(int), s->levels, fp) == (size_t)s->levels;
+    for (int h = 0; ok && h < s->levels; ++h)
+        ok = io_fwrite(s->items[h], sizeof(float), s->size[h], fp) == (size_t)s->size[h];
+    return ok;
+}
+
+int kll_read(FILE *fp, KllSketch *s) {
+    kll_init(s, 0);
+    int levels, size[KLL_MAX_LEVELS];
+    int ok = io_fread(&s->n, sizeof(s->n), 1, fp) == 1 && io_fread(&s->sum, sizeof(s->sum), 1, fp) == 1 &&
+             io_fread(&s->sumsq, sizeof(s->sumsq), 1, fp) == 1 && io_fread(&s->min, sizeof(s->min), 1, fp) == 1 &&
+             io_fread(&s->max, sizeof(s->max), 1, fp) == 1 && io_fread(&s->rng, sizeof(s->rng), 1, fp) == 1 &&
+             io_fread(&levels, sizeof(levels), 1, fp) == 1 && levels >= 1 && levels <= KLL_MAX_LEVELS &&
+             io_fread(size, sizeof(int), levels, fp) == (size_t)levels;
+    if (ok) kll_set_levels(s, levels);
+    for (int h = 0; ok && h < levels; ++h) {
+        ok = size[h] >= 0 && size[h] <= s->capacity;
+        for (int i = 0; ok && i < size[h]; ++i) {
+            float x;
+            ok = io_fread(&x, sizeof(x), 1, fp) == 1 && kll_push(s, h, x);
+        }
+    }
+    if (!ok) kll_free(s);
+    return ok;
+}
+
+// Load the sketches of SKETCH_FILE if it matches the current layout and
+// describes DATA_FILE as of `want`. Returns the slots they cover, or -1.
+int sketch_load(KllSketch *cols, int ncols, DataStamp want) {
+    FILE *fp = io_fopen(SKETCH_FILE, "rb");
+    if (!fp) return -1;
+    SketchHeader h;
+    int ok = io_fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, "SQSK", 4) == 0 && h.version == 2 &&
+             h.subjects == SUBJECT_COUNT && h.record_size == RECORD_SIZE && h.columns == ncols && h.slots >= 0 &&
+             stamp_equal(h.data, want);
+    int c = 0;
+    for (; ok && c < ncols; ++c) ok = kll_read(fp, &cols[c]);
+    fclose(fp);
+    if (!ok) { while (c-- > 0) kll_free(&cols[c]); return -1; }
+    return h.slots;
+}
+
+int sketch_save(const KllSketch *cols, int ncols, int slots, DataStamp at) {
+    SketchHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "SQSK", 4);
+    h.version = 2;
+    h.subjects = SUBJECT_COUNT;
+    h.record_size = RECORD_SIZE;
+    h.columns = ncols;
+    h.slots = slots;
+    h.data = at;
+    FILE *fp = io_fopen("temp.qsk", "wb");
+    int ok = fp && io_fwrite(&h, sizeof(h), 1, fp) == 1;
+    for (int c = 0; ok && c < ncols; ++c) ok = kll_write(fp, &cols[c]);
+    if (fp) ok = (fclose(fp) == 0) && ok;
+    if (ok) ok = replace_file("temp.qsk", SKETCH_FILE) == 0;
+    if (!ok) remove("temp.qsk");
+    return ok;
+}
+
+// A record was appended: the sketches still cover their slots, so if they
+// matched DATA_FILE as of `before` they are re-stamped and the new slot
+// is folded in on next use. Otherwise they stay stale and are rebuilt.
+void sketch_restamp(DataStamp before) {
+    FILE *fp = io_fopen(SKETCH_FILE, "r+b");
+    if (!fp) return;
+    SketchHeader h;
+    if (io_fread(&h, sizeof(h), 1, fp) == 1 && memcmp(h.magic, "SQSK", 4) == 0 && stamp_equal(h.data, before)) {
+        data_file_stamp(&h.data);
+        fseek(fp, 0, SEEK_SET);
+        io_fwrite(&h, sizeof(h), 1, fp);
+    }
+    fclose(fp);
+}
+
+typedef struct {
+    const StudentView *v;
+    int from;                       // first slot to fold in
+    int ncols;
+    KllSketch *parts;               // ncols sketches per part
+} SketchBuild;
+
+void sketch_build_part(void *arg, int part, int begin, int end) {
+    SketchBuild *b = arg;
+    KllSketch *s = b->parts + (size_t)part * b->ncols;
+    for (int c = 0; c < b->ncols; ++c) kll_init(&s[c], 0x9E3779B97F4A7C15ull * (uint64_t)(part * DIST_COLUMNS + c + 1));
+    for (int i = b->from + begin; i < b->from + end; ++i) {
+        const StudentRec *r = view_rec(b->v, i);
+        if (is_deleted(r)) continue;
+        kll_add(&s[0], r->percentage);
+        for (int c = 1; c < b->ncols; ++c) kll_add(&s[c], r->marks[c - 1]);
+    }
+}
+
+// Sketches of every column, up to date with DATA_FILE: slots appended
+// since SKETCH_FILE was written are sketched in parallel parts and merged
+// in; a missing, foreign or stale file is rebuilt from all slots. Returns the
+// number of columns (free them with kll_free), 0 if there is no data.
+int sketches_get(KllSketch *cols) {
+    StudentView v;
+    DataStamp at = data_stamp(); // taken first: a change while we read makes the save stale, not wrong
+    if (!data_view(&v)) return 0;
+    int ncols = v.subjects + 1;
+    int from = sketch_load(cols, ncols, at);
+    if (from > v.slots) {
+        for (int c = 0; c < ncols; ++c) kll_free(&cols[c]);
+        from = -1;
+    }
+    if (from < 0) {
+        for (int c = 0; c < ncols; ++c) kll_init(&cols[c], (uint64_t)c + 1);
+        from = 0;
+    }
+    if (from < v.slots) {
+        int n = v.slots - from, parts = parallel_parts(n, SCAN_MIN_CHUNK);
+        SketchBuild b = { &v, from, ncols, malloc(sizeof(KllSketch) * parts * ncols) };
+        if (!b.parts) { for (int c = 0; c < ncols; ++c) kll_free(&cols[c]); return 0; }
+        metric_count(MC_SCANNED, (uint64_t)n);
+        parallel_for(n, parts, sketch_build_part, &b);
+        for (int p = 0; p < parts; ++p)
+            for (int c = 0; c < ncols; ++c) {
+                kll_merge(&cols[c], &b.parts[p * ncols + c]);
+                kll_free(&b.parts[p * ncols + c]);
+            }
+        free(b.parts);
+        int failed = 0;
+        for (int c = 0; c < ncols; ++c) failed |= cols[c].failed;
+        if (!failed) sketch_save(cols, ncols, v.slots, at);
+    }
+    return ncols;
+}
+
+// Distributions of the percentage and every subject: exact from the
+// columns, or from the sketches when *approx is set on entry or the class
+// is larger than DIST_EXACT_MAX. *approx tells which was used. Returns the
+// number of columns, 0 if there are no records, -1 on error.
+int distribution_get(Distribution *out, int *approx) {
+    MetricScope m;
+    metric_begin(&m, MOP_DISTRIBUTION);
+    int live, tombstones;
+    if (!*approx && index_counts(&live, &tombstones) && live > DIST_EXACT_MAX) *approx = 1;
+    if (!*approx) return metric_end(&m, distribution_exact(out));
+    KllSketch cols[DIST_COLUMNS];
+    int ncols = sketches_get(cols), rc = ncols > 0 && cols[0].n > 0 ? ncols : 0;
+    for (int c = 0; c < ncols; ++c) {
+        if (rc > 0 && !kll_distribution(&cols[c], &out[c])) rc = -1;
+        kll_free(&cols[c]);
+    }
+    return metric_end(&m, rc);
+}
+
+// -------- STATISTICS & ANALYTICS --------
+typedef struct {
+    int count;
+    double average;                     // of percentage
+    int highest_slot, lowest_slot;
+    int grade_counts[5];                // A,B,C,D,F
+    int subj_topper_slot[MAX_SUBJECTS];
+    float subj_max[MAX_SUBJECTS];
+    double subj_avg[MAX_SUBJECTS];
+} ClassStats;
+
+// Recompute the extremes flagged in sf->dirty from the columns.
+void stats_recompute_extremes(StatsFile *sf, const ColumnStore *c, const ColumnReduction *r) {
+    if (sf->dirty & STATS_DIRTY_HIGHEST) {
+        sf->highest = c->percentage[r->highest];
+        sf->highest_slot = c->slot[r->highest];
+    }
+    if (sf->dirty & STATS_DIRTY_LOWEST) {
+        sf->lowest = c->percentage[r->lowest];
+        sf->lowest_slot = c->slot[r->lowest];
+    }
+    for (int j = 0; j < c->subjects; ++j) {
+        if (!(sf->dirty & STATS_DIRTY_SUBJECT(j))) continue;
+        sf->subj_max[j] = c->marks[j][r->subj_top[j]];
+        sf->subj_topper_slot[j] = c->slot[r->subj_top[j]];
+    }
+    sf->dirty = 0;
+}
+
+// Compute STATS_FILE from scratch.
+int stats_rebuild(StatsFile *sf) {
+    memset(sf, 0, sizeof(*sf));
+    sf->highest_slot = sf->lowest_slot = -1;
+    for (int j = 0; j < MAX_SUBJECTS; ++j) sf->subj_topper_slot[j] = -1;
+    const ColumnStore *c = columns_get();
+    ColumnReduction r;
+    if (c && columns_reduce(c, &r)) {
+        sf->count = c->count;
+        sf->sum_percentage = r.sum_percentage;
+        for (int j = 0; j < c->subjects; ++j) sf->subj_sum[j] = r.subj_sum[j];
+        memcpy(sf->grade_counts, r.grade_counts, sizeof(sf->grade_counts));
+        sf->dirty = STATS_DIRTY_HIGHEST | STATS_DIRTY_LOWEST;
+        for (int j = 0; j < c->subjects; ++j) sf->dirty |= STATS_DIRTY_SUBJECT(j);
+        stats_recompute_extremes(sf, c, &r);
+    }
+    return stats_write(sf);
+}
+
+// Aggregates of the live records, read from the stats sidecar (rebuilt
+// if stale; dirty extremes are recomputed here). Returns 0 if there are
+// no records.
+int class_stats(ClassStats *st) {
+    MetricScope m;
+    metric_begin(&m, MOP_ANALYTICS);
+    StatsFile sf;
+    if (!stats_read(&sf) || !stamp_equal(sf.data, data_stamp())) {
+        stats_rebuild(&sf);
+    } else if (sf.dirty && sf.count > 0) {
+        const ColumnStore *c = columns_get();
+        ColumnReduction r;
+        if (!c || !columns_reduce(c, &r)) return metric_end(&m, 0);
+        stats_recompute_extremes(&sf, c, &r);
+        stats_write(&sf);
+    }
+    if (sf.count <= 0) return metric_end(&m, 0);
+    st->count = sf.count;
+    st->average = sf.sum_percentage / sf.count;
+    st->highest_slot = sf.highest_slot;
+    st->lowest_slot = sf.lowest_slot;
+    memcpy(st->grade_counts, sf.grade_counts, sizeof(st->grade_counts));
+    for (int j = 0; j < SUBJECT_COUNT; ++j) {
+        st->subj_topper_slot[j] = sf.subj_topper_slot[j];
+        st->subj_max[j] = sf.subj_max[j];
+        st->subj_avg[j] = sf.subj_sum[j] / sf.count;
+    }
+    return metric_end(&m, 1);
+}
+
+// Quartiles, deciles and histogram of the percentage and each subject.
+// Reads every mark (or the sketches), so the summary screen only shows it
+// on request.
+void print_distribution() {
+    Distribution d[DIST_COLUMNS];
+    int approx = 0, ncols = distribution_get(d, &approx);
+    if (ncols <= 0) { printf(COL_RED "No records found.\n" COL_RESET); return; }
+    printf("\nDistribution%s:\n", approx ? " (approximate)" : "");
+    printf(" %-12s %8s %8s %8s %8s %8s %8s %8s\n", "", "Mean", "StdDev", "Min", "Q1", "Median", "Q3", "Max");
+    for (int c = 0; c < ncols; ++c)
+        printf(" %-12.12s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", c == 0 ? "Percentage" : SUBJECT_NAMES[c - 1],
+               d[c].mean, d[c].stddev, d[c].min, d[c].q[2], d[c].q[5], d[c].q[8], d[c].max);
+    printf("\nDeciles:\n %-12s", "");
+    for (int i = 0; i < DIST_QUANTILES; ++i) if (i != 2 && i != 8) printf(" %6s", DIST_Q_NAMES[i]);
+    printf("\n");
+    for (int c = 0; c < ncols; ++c) {
+        printf(" %-12.12s", c == 0 ? "Percentage" : SUBJECT_NAMES[c - 1]);
+        for (int i = 0; i < DIST_QUANTILES; ++i) if (i != 2 && i != 8) printf(" %6.2f", d[c].q[i]);
+        printf("\n");
+    }
+    printf("\nPercentage histogram:\n");
+    int64_t peak = 1;
+    for (int b = 0; b < DIST_BINS; ++b) if (d[0].hist[b] > peak) peak = d[0].hist[b];
+    for (int b = 0; b < DIST_BINS; ++b) {
+        printf(" %3d-%-3d %10lld ", b * 10, b == DIST_BINS - 1 ? 100 : b * 10 + 9, (long long)d[0].hist[b]);
+        for (int w = (int)(40 * d[0].hist[b] / peak); w > 0; --w) putchar('#');
+        printf("\n");
+    }
+}
+
+void analytics_feature() {
+    ClassStats st;
+    StudentView v;
+    if (!class_stats(&st) || !data_view(&v)) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
+    clear_screen();
+    printf(COL_CYAN "----- Analytics & Statistics -----\n" COL_RESET);
+
+    const StudentRec *hi = view_rec(&v, st.highest_slot), *lo = view_rec(&v, st.lowest_slot);
+    printf("Class size: %d\n", st.count);
+    printf("Class average percentage: %.2f\n", st.average);
+    printf("Topper (overall): %s (Roll %d) - %.2f%%\n", hi->name, hi->rollNo, hi->percentage);
+    printf("Lowest (overall): %s (Roll %d) - %.2f%%\n", lo->name, lo->rollNo, lo->percentage);
+
+    printf("\nSubject-wise toppers:\n");
+    for (int j = 0; j < SUBJECT_COUNT; ++j) {
+        const StudentRec *r = view_rec(&v, st.subj_topper_slot[j]);
+        printf(" %s : %s (Roll %d) - %.2f (avg %.2f)\n", SUBJECT_NAMES[j], r->name, r->rollNo, st.subj_max[j], st.subj_avg[j]);
+    }
+
+    printf("\nGrade distribution:\n");
+    printf(" A: %d\n B: %d\n C: %d\n D: %d\n F: %d\n", st.grade_counts[0], st.grade_counts[1], st.grade_counts[2], st.grade_counts[3], st.grade_counts[4]);
+
+    printf("\nShow distribution (quartiles, deciles, histogram)? (y/N): ");
+    char ans[8];
+    safe_fgets(ans, sizeof(ans));
+    if (ans[0] == 'y' || ans[0] == 'Y') print_distribution();
+    pause_anykey();
+}
+
+// -------- TOPPER & RANKING --------
+#define RANK_HEAP_SHARE 16 // top-k through a heap while k <= slots / this
+// Ranking order: higher percentage first, ties by lower roll number.
+int ranks_before(const StudentRec *a, const StudentRec *b) {
+    if (a->percentage != b->percentage) return a->percentage > b->percentage;
+    return a->rollNo < b->rollNo;
+}
+
+// Restore the heap below i. The root is the record ranked last, so heap
+// order is the reverse of ranking order.
+void rank_sift_down(const StudentRec **heap, int n, int i) {
+    while (1) {
+        int worst = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && ranks_before(heap[worst], heap[l])) worst = l;
+        if (r < n && ranks_before(heap[worst], heap[r])) worst = r;
+        if (worst == i) return;
+        const StudentRec *t = heap[i]; heap[i] = heap[worst]; heap[worst] = t;
+        i = worst;
+    }
+}
+
+void rank_sift_up(const StudentRec **heap, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!ranks_before(heap[parent], heap[i])) return;
+        const StudentRec *t = heap[i]; heap[i] = heap[parent]; heap[parent] = t;
+        i = parent;
+    }
+}
+
+// Ranking of all live records: radix sort of (percentage, roll) keys, the
+// same order as the percentage tree, then the pointers in that order.
+const StudentRec **rank_sorted(const StudentView *v, int k, int *count) {
+    SortKey *keys = malloc(sizeof(SortKey) * v->slots);
+    if (!keys) return NULL;
+    int n = 0;
+    for (int slot = 0; slot < v->slots; ++slot) {
+        const StudentRec *r = view_rec(v, slot);
+        if (is_deleted(r)) continue;
+        keys[n].key = bt_sort_key(BT_PERCENTAGE, r);
+        keys[n++].idx = slot;
+    }
+    int ok = n > 0 && sort_keys(keys, n, NULL, NULL, 1);
+    if (n > k) n = k;
+    const StudentRec **out = ok ? malloc(sizeof(*out) * n) : NULL;
+    for (int i = 0; out && i < n; ++i) out[i] = view_rec(v, keys[i].idx);
+    free(keys);
+    *count = out ? n : 0;
+    return out;
+}
+
+// The k best live records (all of them when k <= 0), best first. A small
+// k takes one pass over the data view through a bounded heap, O(n log k)
+// time and O(k) memory; a large one sorts all keys (rank_sorted). Caller
+// frees the array; NULL when there are no records.
+const StudentRec **rank_top_k(int k, int *count) {
+    *count = 0;
+    StudentView v;
+    if (!data_view(&v) || v.slots == 0) return NULL;
+    if (k <= 0 || k > v.slots) k = v.slots;
+    if (k > v.slots / RANK_HEAP_SHARE) {
+        MetricScope m;
+        metric_begin(&m, MOP_RANK);
+        metric_count(MC_SCANNED, (uint64_t)v.slots);
+        const StudentRec **out = rank_sorted(&v, k, count);
+        metric_end(&m, 0);
+        return out;
+    }
+    const StudentRec **heap = malloc(sizeof(*heap) * k);
+    if (!heap) return NULL;
+    MetricScope m;
+    metric_begin(&m, MOP_RANK);
+    metric_count(MC_SCANNED, (uint64_t)v.slots);
+    int n = 0;
+    for (int slot = 0; slot < v.slots; ++slot) {
+        const StudentRec *r = view_rec(&v, slot);
+        if (is_deleted(r)) continue;
+        if (n < k) {
+            heap[n] = r;
+            rank_sift_up(heap, n++);
+        } else if (ranks_before(r, heap[0])) {
+            heap[0] = r;
+            rank_sift_down(heap, n, 0);
+        }
+    }
+    // pop the worst to the back until the array is in ranking order
+    for (int end = n - 1; end > 0; --end) {
+        const StudentRec *t = heap[0]; heap[0] = heap[end]; heap[end] = t;
+        rank_sift_down(heap, end, 0);
+    }
+    metric_end(&m, 0);
+    *count = n;
+    if (n == 0) { free(heap); return NULL; }
+    return heap;
+}
+
+void show_topper_and_ranking() {
+    printf("Show top how many students (0 = all)? ");
+    int k;
+    if (scanf("%d", &k) != 1) k = 0;
+    while (getchar() != '\n');
+    int count = 0;
+    const StudentRec **arr = rank_top_k(k, &count);
+    if (!arr) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
+    fb_clear();
+    fb_printf(COL_CYAN "----- Class Ranking -----\n" COL_RESET);
+    display_table_header();
+    for (int i = 0; i < count; ++i) {
+        fb_printf("%2d) ", i+1);
+        print_student_row(arr[i]);
+    }
+    if (count > 0) fb_printf(COL_GREEN "\nTopper: %s (Roll %d) - %.2f%%\n" COL_RESET, arr[0]->name, arr[0]->rollNo, arr[0]->percentage);
+    free(arr);
+    pause_anykey();
+}
+
+// -------- HEADLESS COMMAND LINE --------
+// g1 <command> [args]: no welcome screen, menus or screen clearing. Records
+// are printed one per line as tab-separated fields
+//   roll, name, marks per subject..., total, percentage, grade
+// and key/value results as "key<TAB>value". Errors go to stderr.
+// Exit status: 0 ok, 1 usage or I/O error, 2 not found / nothing matched /
+// duplicate roll / rejected import lines.
+void cli_print_record(const StudentRec *s) {
+    printf("%d\t%s", s->rollNo, s->name);
+    for (int i = 0; i < SUBJECT_COUNT; ++i) printf("\t%.2f", s->marks[i]);
+    printf("\t%.2f\t%.2f\t%c\n", s->total, s->percentage, s->grade);
+}
+
+// Class statistics with slots resolved to roll numbers, as printed by
+// "g1 analytics" and sent by the daemon.
+typedef struct {
+    int32_t count;
+    double average;
+    int32_t highest_roll, lowest_roll;
+    float highest_percentage, lowest_percentage;
+    int32_t grade_counts[5];
+    int32_t subj_topper_roll[MAX_SUBJECTS];
+    float subj_max[MAX_SUBJECTS];
+    double subj_avg[MAX_SUBJECTS];
+} AnalyticsSummary;
+
+int analytics_summary(AnalyticsSummary *a) {
+    ClassStats st;
+    StudentView v;
+    if (!class_stats(&st) || !data_view(&v)) return 0;
+    memset(a, 0, sizeof(*a));
+    a->count = st.count;
+    a->average = st.average;
+    a->highest_roll = view_rec(&v, st.highest_slot)->rollNo;
+    a->highest_percentage = view_rec(&v, st.highest_slot)->percentage;
+    a->lowest_roll = view_rec(&v, st.lowest_slot)->rollNo;
+    a->lowest_percentage = view_rec(&v, st.lowest_slot)->percentage;
+    for (int g = 0; g < 5; ++g) a->grade_counts[g] = st.grade_counts[g];
+    for (int j = 0; j < SUBJECT_COUNT; ++j) {
+        a->subj_topper_roll[j] = view_rec(&v, st.subj_topper_slot[j])->rollNo;
+        a->subj_max[j] = st.subj_max[j];
+        a->subj_avg[j] = st.subj_avg[j];
+    }
+    return 1;
+}
+
+void cli_print_analytics(const AnalyticsSummary *a) {
+    printf("count\t%d\n", a->count);
+    printf("average\t%.2f\n", a->average);
+    printf("highest\t%d\t%.2f\n", a->highest_roll, a->highest_percentage);
+    printf("lowest\t%d\t%.2f\n", a->lowest_roll, a->lowest_percentage);
+    for (int j = 0; j < SUBJECT_COUNT; ++j)
+        printf("subject\t%s\t%.2f\t%d\t%.2f\n", SUBJECT_NAMES[j], a->subj_avg[j], a->subj_topper_roll[j], a->subj_max[j]);
+    printf("grades\t%d\t%d\t%d\t%d\t%d\n", a->grade_counts[0], a->grade_counts[1], a->grade_counts[2], a->grade_counts[3], a->grade_counts[4]);
+}
+
+void cli_usage() {
+    fprintf(stderr,
+        "usage: g1 <command> [args]\n"
+        "  add <roll> <name> <marks>...   add a student (one mark per subject)\n"
+        "  get <roll>                     print one student\n"
+        "  search name <text>             case-insensitive name substring\n"
+        "  search grade <A-F...> [text]   students with any of the grades,\n"
+        "                                 optionally also matching a name\n"
+        "  rank [K]                       ranking by percentage (top K, default all)\n"
+        "  analytics                      class statistics\n"
+        "  distribution [--approx] [--histogram]\n"
+        "                                 mean, stddev, min, deciles, quartiles and\n"
+        "                                 max (or histograms) of the percentage and\n"
+        "                                 each subject; approx reads KLL sketches\n"
+        "                                 (%s), the default above %d records\n"
+        "  backup [--incremental|--compress] [file]\n"
+        "                                 copy %s (default %s); incremental\n"
+        "                                 adds only the changed blocks,\n"
+        "                                 compress writes an LZ stream\n"
+        "  restore [--upto N] [file]      restore a backup, replaying its\n"
+        "                                 incrementals (up to the Nth)\n"
+        "  report <roll>                  write a report card\n"
+        "  reports [--grade G] [--from R] [--to R]\n"
+        "                                 report cards for the whole class\n"
+        "  import [file|-]                bulk import roll|name|marks... lines\n"
+        "  subjects                       list the configured subjects\n"
+        "  storage [file|log]             show or switch the storage engine\n"
+        "  serve [socket]                 answer clients on a Unix socket\n"
+        "                                 (default %s) until interrupted\n"
+        "  client [--socket S] <command>  run get, search, rank, analytics,\n"
+        "                                 add, update <roll> <name> <marks>...\n"
+        "                                 or delete <roll> on the daemon\n"
+        "  loadgen [--socket S] [--clients N] [--seconds T] [--writes PCT]\n"
+        "                                 measure daemon throughput and latency\n"
+        "  gen <N> [--subjects K] [--seed S] [--force]\n"
+        "                                 replace the data with N synthetic students\n"
+        "  bench [--records N] [--subjects K] [--ops N] [--seed S]\n"
+        "        [--storage file|log] [--dir D]\n"
+        "                                 time every operation on synthetic data in\n"
+        "                                 directory D (default %s)\n"
+        "  checkpoint                     fold the log into %s (log engine)\n"
+        "  stats [--reset]                operation latencies and I/O counters summed\n"
+        "                                 over all runs (%s)\n"
+        "  --stats <command>              also print this run's metrics to stderr\n",
+        SKETCH_FILE, DIST_EXACT_MAX, DATA_FILE, BACKUP_FILE, SOCKET_FILE, BENCH_DIR, DATA_FILE, METRICS_FILE);
+}
+
+int cli_parse_int(const char *arg, int *out) {
+    char *end;
+    long v = strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0') return 0;
+    *out = (int)v;
+    return 1;
+}
+
+// Parse "<cmd> <roll> <name> <marks>..." into s. Returns 0, or the exit
+// status after printing what was wrong.
+int cli_parse_student(int argc, char **argv, Student *s) {
+    memset(s, 0, sizeof(*s));
+    if (argc != 3 + SUBJECT_COUNT || !cli_parse_int(argv[1], &s->rollNo)) { cli_usage(); return 1; }
+    snprintf(s->name, sizeof(s->name), "%s", argv[2]);
+    if (strlen(s->name) == 0) strcpy(s->name, "Unnamed Student");
+    to_titlecase(s->name);
+    for (int i = 0; i < SUBJECT_COUNT; ++i) {
+        char *end;
+        s->marks[i] = strtof(argv[3 + i], &end);
+        if (*argv[3 + i] == '\0' || *end != '\0') { fprintf(stderr, "invalid marks: %s\n", argv[3 + i]); return 1; }
+    }
+    return 0;
+}
+
+// -------- SYNTHETIC DATA & BENCHMARK --------
+// "g1 gen" writes a synthetic class of any size straight into DATA_FILE;
+// "g1 bench" generates one in a scratch directory and times every
+// operation path on it, printing one tab-separated line per operation:
+//   op, iterations, ops per second, p50/p90/p99/max latency in microseconds
+// after a "#" line with the parameters, so runs can be diffed and graphed.
+#define GEN_BATCH 65536
+#define BENCH_BACKUP "bench_backup.dat"
+
+const char *GEN_FIRST_NAMES[] = {
+    "Aarav", "Aditi", "Akash", "Amara", "Ananya", "Arjun", "Chen", "Daniel", "Diya", "Elena", "Farah", "Gabriel",
+    "Hana", "Ishaan", "Jonas", "Kavya", "Leila", "Lucas", "Maya", "Mei", "Mohammed", "Nadia", "Noah", "Olivia",
+    "Priya", "Rahul", "Rohan", "Sara", "Sofia", "Tariq", "Yusuf", "Zoe" };
+const char *GEN_LAST_NAMES[] = {
+    "Agarwal", "Bose", "Brown", "Chatterjee", "Costa", "Das", "Fernandes", "Garcia", "Gupta", "Hassan", "Iyer",
+    "Joshi", "Kapoor", "Khan", "Kim", "Kumar", "Lee", "Menon", "Mehta", "Nair", "Novak", "Patel", "Rao", "Reddy",
+    "Rossi", "Sharma", "Silva", "Singh", "Smith", "Tanaka", "Verma", "Wang" };
+const char *GEN_SUBJECTS[MAX_SUBJECTS] = {
+    "Mathematics", "Physics", "Chemistry", "Biology", "English", "History", "Geography", "Economics", "Computer", "Art" };
+
+void gen_student(Student *s, int roll, uint64_t *rng) {
+    memset(s, 0, sizeof(*s));
+    s->rollNo = roll;
+    uint64_t r = splitmix64(rng);
+    snprintf(s->name, sizeof(s->name), "%s %c. %s", GEN_FIRST_NAMES[r % 32], 'A' + (int)((r >> 8) % 26),
+             GEN_LAST_NAMES[(r >> 16) % 32]);
+    int ability = 25 + (int)((r >> 24) % 66); // marks cluster around one level per student
+    for (int j = 0; j < SUBJECT_COUNT; ++j) {
+        int m = ability + (int)(splitmix64(rng) % 41) - 20;
+        s->marks[j] = (float)(m < 0 ? 0 : m > 100 ? 100 : m);
+    }
+    recalc_student(s);
+}
+
+// Replace DATA_FILE with `records` synthetic students over `subjects`
+// subjects, rolls 1..records in shuffled order. Returns 1 on success.
+int generate_dataset(int records, int subjects, uint64_t seed) {
+    char names[MAX_SUBJECTS][SUBJECT_NAME_LEN];
+    for (int j = 0; j < subjects; ++j) snprintf(names[j], sizeof(names[j]), "%s", GEN_SUBJECTS[j]);
+    data_view_invalidate();
+    SUBJECT_COUNT = subjects;
+    memcpy(SUBJECT_NAMES, names, sizeof(names[0]) * subjects);
+    save_subjects();
+    set_record_layout();
+    int32_t *rolls = malloc(sizeof(int32_t) * (records > 0 ? records : 1));
+    unsigned char *batch = malloc((size_t)GEN_BATCH * RECORD_SIZE);
+    FILE *fp = io_fopen("temp.dat", "wb");
+    int ok = rolls && batch && fp && write_data_header(fp);
+    uint64_t rng = seed;
+    for (int i = 0; ok && i < records; ++i) rolls[i] = i + 1;
+    for (int i = records - 1; ok && i > 0; --i) { // Fisher-Yates
+        int k = (int)(splitmix64(&rng) % (uint64_t)(i + 1));
+        int32_t t = rolls[i]; rolls[i] = rolls[k]; rolls[k] = t;
+    }
+    for (int done = 0; ok && done < records;) {
+        int n = records - done < GEN_BATCH ? records - done : GEN_BATCH;
+        for (int i = 0; i < n; ++i) {
+            Student s;
+            gen_student(&s, rolls[done + i], &rng);
+            student_to_rec(&s, (StudentRec *)(batch + (size_t)i * RECORD_SIZE));
+        }
+        ok = io_fwrite(batch, RECORD_SIZE, n, fp) == (size_t)n;
+        done += n;
+    }
+    if (fp) { ok = sync_file(fp) && ok; ok = (fclose(fp) == 0) && ok; }
+    free(rolls);
+    free(batch);
+    if (!ok) { remove("temp.dat"); return 0; }
+    if (replace_file("temp.dat", DATA_FILE) != 0) { remove("temp.dat"); return 0; }
+    metric_count(MC_REWRITES, 1);
+    log_reset();
+    indexes_rebuild_all();
+    return 1;
+}
+
+// Build every sidecar and cache up front, so no timed operation pays for
+// a rebuild that only the first call would see.
+void bench_warm() {
+    StudentView v;
+    data_view(&v);
+    IndexHeader ih;
+    FILE *fp = index_open(&ih, 1);
+    if (fp) fclose(fp);
+    TriHeader th;
+    if ((fp = tri_open(&th, 1))) fclose(fp);
+    gbm_get();
+    for (int k = 0; k < BT_KINDS; ++k) {
+        BTree t;
+        if (bt_open(k, &t, 1)) bt_close(&t);
+    }
+    ClassStats st;
+    class_stats(&st);
+}
+
+typedef struct {
+    int64_t *ns;
+    int n, cap;
+    double t0;
+} BenchTimer;
+
+void bench_start(BenchTimer *b, int iterations) {
+    b->ns = malloc(sizeof(int64_t) * (iterations > 0 ? iterations : 1));
+    b->n = 0;
+    b->cap = b->ns ? iterations : 0;
+}
+
+void bench_begin(BenchTimer *b) { b->t0 = monotonic_seconds(); }
+
+void bench_end(BenchTimer *b) {
+    double t = monotonic_seconds();
+    if (b->n < b->cap) b->ns[b->n++] = (int64_t)((t - b->t0) * 1e9);
 }
 
-Student *load_all_students(int *count) {
-    *count = 0;
-    FILE *fp = fopen(DATA_FILE, "rb");
-    if (!fp) return NULL;
-    fseek(fp, 0, SEEK_END);
-    long sz = ftell(fp);
-    rewind(fp);
-    int total = (int)(sz / sizeof(Student));
-    if (total <= 0) { fclose(fp); return NULL; }
-    Student *arr = malloc(sizeof(Student) * total);
-    if (!arr) { fclose(fp); return NULL; }
-    int idx = 0;
-    while (fread(&arr[idx], sizeof(Student), 1, fp) == 1) idx++;
-    fclose(fp);
-    *count = idx;
-    return arr;
+int compare_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
 }
 
-void print_student_row(const Student *s) {
-    printf("%-8d | %-25s |", s->rollNo, s->name);
-    for (int i = 0; i < SUBJECT_COUNT; ++i) {
-        printf(" %6.2f |", s->marks[i]);
+// Print the line for one operation and release its samples.
+void bench_report(const char *op, BenchTimer *b) {
+    if (b->n > 0) {
+        double total = 0;
+        for (int i = 0; i < b->n; ++i) total += b->ns[i];
+        qsort(b->ns, b->n, sizeof(int64_t), compare_i64);
+        printf("%s\t%d\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n", op, b->n, total > 0 ? b->n / (total / 1e9) : 0.0,
+               b->ns[(b->n - 1) * 50 / 100] / 1e3, b->ns[(b->n - 1) * 90 / 100] / 1e3,
+               b->ns[(b->n - 1) * 99 / 100] / 1e3, b->ns[b->n - 1] / 1e3);
+        fflush(stdout);
     }
-    printf(" %7.2f | %6.2f |   %c\n", s->total, s->percentage, s->grade);
+    free(b->ns);
+    b->ns = NULL;
 }
 
-void display_table_header() {
-    printf(COL_YELLOW "Roll     | Name                      |" COL_RESET);
-    for (int i = 0; i < SUBJECT_COUNT; ++i) {
-        printf(" %-6s |", SUBJECT_NAMES[i]);
-    }
-    printf("  Total  |   Perc | Grade\n");
-    printf("--------------------------------------------------------------------------------\n");
+// A short piece of a generated surname, the kind of text typed into search.
+void bench_name_query(uint64_t *rng, char *q, size_t len) {
+    const char *last = GEN_LAST_NAMES[splitmix64(rng) % 32];
+    snprintf(q, len, "%.4s", last + (strlen(last) > 4 ? splitmix64(rng) % (strlen(last) - 3) : 0));
 }
 
-void paginate_and_display(Student *arr, int count) {
-    if (!arr || count == 0) {
-        printf(COL_RED "No records to display.\n" COL_RESET);
-        pause_anykey();
-        return;
+// g1 bench [--records N] [--subjects N] [--ops N] [--seed S] [--storage file|log] [--dir D]
+int bench_main(int argc, char **argv) {
+    int records = 100000, subjects = 3, ops = 1000, seed = 1, use_log = 0;
+    const char *dir = BENCH_DIR;
+    for (int i = 2; i < argc; i += 2) {
+        int *target = strcmp(argv[i], "--records") == 0 ? &records : strcmp(argv[i], "--subjects") == 0 ? &subjects :
+                      strcmp(argv[i], "--ops") == 0 ? &ops : strcmp(argv[i], "--seed") == 0 ? &seed : NULL;
+        if (i + 1 < argc && strcmp(argv[i], "--dir") == 0) { dir = argv[i + 1]; continue; }
+        if (i + 1 < argc && strcmp(argv[i], "--storage") == 0 && (strcmp(argv[i + 1], "file") == 0 || strcmp(argv[i + 1], "log") == 0)) {
+            use_log = argv[i + 1][0] == 'l';
+            continue;
+        }
+        if (!target || i + 1 >= argc || !cli_parse_int(argv[i + 1], target)) { cli_usage(); return 1; }
     }
-    int pages = (count + RECORDS_PER_PAGE - 1) / RECORDS_PER_PAGE;
-    int current = 0;
-    while (1) {
-        clear_screen();
-        printf(COL_CYAN "----- All Student Records (Page %d of %d) -----\n" COL_RESET, current+1, pages);
-        display_table_header();
-        int start = current * RECORDS_PER_PAGE;
-        int end = start + RECORDS_PER_PAGE;
-        if (end > count) end = count;
-        for (int i = start; i < end; ++i) print_student_row(&arr[i]);
-        printf("--------------------------------------------------------------------------------\n");
-        printf("n: next page, p: prev page, q: quit display\n");
-        int ch = getchar();
-        if (ch == '\n') ch = getchar(); // handle previous newline
-        if (ch == 'n' || ch == 'N') {
-            if (current + 1 < pages) current++;
-        } else if (ch == 'p' || ch == 'P') {
-            if (current > 0) current--;
-        } else {
-            break;
+    if (records < 1 || subjects < 1 || subjects > MAX_SUBJECTS || ops < 1) { cli_usage(); return 1; }
+#ifdef _WIN32
+    CreateDirectoryA(dir, NULL);
+    if (!SetCurrentDirectoryA(dir)) { fprintf(stderr, "cannot use directory %s\n", dir); return 1; }
+#else
+    mkdir(dir, 0755);
+    if (chdir(dir) != 0) { fprintf(stderr, "cannot use directory %s\n", dir); return 1; }
+#endif
+    remove(JOURNAL_FILE);
+    remove(LOG_FILE);
+    load_storage_mode();
+    if (!storage_set_mode(use_log)) { fprintf(stderr, "cannot select the storage engine\n"); return 1; }
+
+    uint64_t rng = (uint64_t)seed;
+    int heavy = ops / 100 < 3 ? 3 : ops / 100;  // iterations of whole-class operations
+    BenchTimer b;
+    printf("# g1-bench 1\trecords=%d\tsubjects=%d\tops=%d\tseed=%d\tstorage=%s\tthreads=%d\n",
+           records, subjects, ops, seed, use_log ? "log" : "file", pool_threads());
+    printf("op\tcount\tops_per_sec\tp50_us\tp90_us\tp99_us\tmax_us\n");
+
+    bench_start(&b, 1);
+    bench_begin(&b);
+    int ok = generate_dataset(records, subjects, (uint64_t)seed);
+    bench_warm();
+    bench_end(&b);
+    if (!ok) { fprintf(stderr, "cannot generate %s\n", DATA_FILE); return 1; }
+    bench_report("generate", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        int roll = 1 + (int)(splitmix64(&rng) % records);
+        bench_begin(&b);
+        find_by_roll(roll);
+        bench_end(&b);
+    }
+    bench_report("lookup_roll", &b);
+
+    char q[16];
+    int n;
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        bench_name_query(&rng, q, sizeof(q));
+        bench_begin(&b);
+        free(find_by_name(q, &n));
+        bench_end(&b);
+    }
+    bench_report("search_name", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        char g[2] = { "ABCDF"[splitmix64(&rng) % 5], 0 };
+        bench_name_query(&rng, q, sizeof(q));
+        bench_begin(&b);
+        free(find_by_grade(g, q, &n));
+        bench_end(&b);
+    }
+    bench_report("search_grade", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) { // open a sorted index and fetch the first page
+        RecordWalk w;
+        memset(&w, 0, sizeof(w));
+        w.node.n = -1;
+        StudentView v;
+        bench_begin(&b);
+        if (bt_open(i % BT_KINDS, &w.tree, 1) && data_view(&v)) {
+            w.sorted = 1;
+            w.cur = bt_first(&w.tree);
+            for (int k = 0; k < RECORDS_PER_PAGE && walk_next(&w, &v); ++k) {}
+            bt_close(&w.tree);
         }
+        bench_end(&b);
     }
-    while (getchar() != '\n'); // clear trailing
+    bench_report("display_page", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        bench_begin(&b);
+        free(rank_top_k(10, &n));
+        bench_end(&b);
+    }
+    bench_report("rank_top10", &b);
+
+    bench_start(&b, heavy);
+    for (int i = 0; i < heavy; ++i) {
+        bench_begin(&b);
+        free(rank_top_k(0, &n));
+        bench_end(&b);
+    }
+    bench_report("rank_all", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        ClassStats st;
+        bench_begin(&b);
+        class_stats(&st);
+        bench_end(&b);
+    }
+    bench_report("analytics", &b);
+
+    Student s;
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        gen_student(&s, records + 1 + i, &rng);
+        bench_begin(&b);
+        add_student(&s);
+        bench_end(&b);
+    }
+    bench_report("add", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        gen_student(&s, 1 + (int)(splitmix64(&rng) % records), &rng);
+        bench_begin(&b);
+        add_student(&s); // rejected by the duplicate check
+        bench_end(&b);
+    }
+    bench_report("add_duplicate", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        gen_student(&s, 1 + (int)(splitmix64(&rng) % records), &rng);
+        bench_begin(&b);
+        update_student(&s);
+        bench_end(&b);
+    }
+    bench_report("update", &b);
+
+    int deletes = ops < records / 10 ? ops : records / 10;
+    bench_start(&b, deletes);
+    for (int i = 0; i < deletes; ++i) { // the students added above
+        bench_begin(&b);
+        delete_student(records + 1 + i, NULL);
+        bench_end(&b);
+    }
+    bench_report("delete", &b);
+
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) { // analytics again, now folding in the deletes
+        ClassStats st;
+        bench_begin(&b);
+        class_stats(&st);
+        bench_end(&b);
+    }
+    bench_report("analytics_after_writes", &b);
+
+    char fname[256];
+    bench_start(&b, ops);
+    for (int i = 0; i < ops; ++i) {
+        const StudentRec *r = find_by_roll(1 + (int)(splitmix64(&rng) % records));
+        bench_begin(&b);
+        if (r) write_report(r, fname, sizeof(fname));
+        bench_end(&b);
+    }
+    bench_report("report", &b);
+
+    ReportFilter f = { "", 1, 1000 };
+    int failed;
+    bench_start(&b, heavy);
+    for (int i = 0; i < heavy; ++i) {
+        bench_begin(&b);
+        generate_reports(&f, &failed);
+        bench_end(&b);
+    }
+    bench_report("reports_1000", &b);
+
+    int restores = heavy < 10 ? heavy : 10;
+    const char *names[] = { "backup_full", "backup_compressed" };
+    for (int c = 0; c < 2; ++c) {
+        bench_start(&b, restores);
+        for (int i = 0; i < restores; ++i) {
+            bench_begin(&b);
+            backup_to(BENCH_BACKUP, c);
+            bench_end(&b);
+        }
+        bench_report(names[c], &b);
+    }
+    int blocks;
+    bench_start(&b, restores);
+    for (int i = 0; i < restores; ++i) {
+        gen_student(&s, 1 + (int)(splitmix64(&rng) % records), &rng);
+        update_student(&s);
+        bench_begin(&b);
+        backup_incremental(BENCH_BACKUP, &blocks);
+        bench_end(&b);
+    }
+    bench_report("backup_incremental", &b);
+
+    bench_start(&b, restores);
+    for (int i = 0; i < restores; ++i) {
+        bench_begin(&b);
+        restore_from(BENCH_BACKUP, -1);
+        bench_end(&b);
+    }
+    bench_report("restore", &b);
+    return 0;
 }
 
-void displayAll_feature() {
-    int count = 0;
-    Student *arr = load_all_students(&count);
-    if (!arr) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
+// -------- QUERY DAEMON --------
+// "g1 serve" keeps the dataset open in one process and answers "g1 client"
+// and "g1 loadgen" over a Unix socket, so concurrent users share one copy
+// of the mapping, caches and sidecars instead of each reloading them.
+// Every message is a fixed header plus a binary payload; records travel in
+// their on-disk encoding. Reads share a reader-writer lock and run in
+// parallel. A write runs alone and brings every lazily built structure up
+// to date before it unlocks, so readers never rebuild anything; a change
+// made by another process is noticed by the data stamp at the start of
+// the next request.
+#define WIRE_MAX_REQUEST 4096
+#define LOADGEN_MAX_CLIENTS 256
 
-    printf("Sort by: 1) Roll 2) Name 3) Percentage(desc) 4) No sort\nEnter choice: ");
-    int choice;
-    if (scanf("%d", &choice) != 1) { choice = 4; }
-    while (getchar() != '\n');
+enum { REQ_GET = 1, REQ_SEARCH_NAME, REQ_SEARCH_GRADE, REQ_RANK, REQ_ANALYTICS, REQ_ADD, REQ_UPDATE, REQ_DELETE };
 
-    if (choice == 1) qsort(arr, count, sizeof(Student), compare_by_roll);
-    else if (choice == 2) qsort(arr, count, sizeof(Student), compare_by_name);
-    else if (choice == 3) qsort(arr, count, sizeof(Student), compare_by_percentage_desc);
+typedef struct {
+    uint8_t op;            // REQ_*
+    uint8_t reserved[3];
+    uint32_t len;          // payload bytes that follow
+} WireRequest;
 
-    paginate_and_display(arr, count);
-    free(arr);
+typedef struct {
+    int32_t status;        // OP_* code
+    uint32_t count;        // records in the payload
+    uint32_t rec_size;     // bytes per record
+    uint32_t len;          // payload bytes that follow
+} WireReply;
+
+#ifndef _WIN32
+int wire_read_all(int fd, void *buf, size_t n) {
+    for (size_t got = 0; got < n;) {
+        ssize_t r = read(fd, (char *)buf + got, n - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return 0;
+        got += (size_t)r;
+    }
+    return 1;
 }
 
-// -------- SEARCH (by roll, name, grade) --------
-void search_feature() {
-    printf("Search by: 1) Roll\n  2) Name\n  3) Grade\nEnter choice: ");
-    int c;
-    if (scanf("%d", &c) != 1) { while (getchar()!='\n'); printf("Invalid.\n"); pause_anykey(); return; }
-    while (getchar() != '\n');
+int wire_write_all(int fd, const void *buf, size_t n) {
+    for (size_t put = 0; put < n;) {
+        ssize_t r = write(fd, (const char *)buf + put, n - put);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return 0;
+        put += (size_t)r;
+    }
+    return 1;
+}
 
-    FILE *fp = fopen(DATA_FILE, "rb");
-    if (!fp) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
+// Reply under construction: the header and payload in one buffer, sent
+// with one write.
+typedef struct {
+    unsigned char *buf;
+    size_t len, cap;
+} ReplyBuf;
 
-    Student s;
-    int found = 0;
-    if (c == 1) {
-        printf("Enter roll to search: ");
-        int r;
-        if (scanf("%d", &r) != 1) { printf("Invalid.\n"); while (getchar()!='\n'); fclose(fp); pause_anykey(); return; }
-        while (fread(&s, sizeof(Student), 1, fp) == 1) {
-            if (s.rollNo == r) {
-                printf(COL_GREEN "Student found:\n" COL_RESET);
-                print_student_row(&s);
-                found = 1; break;
-            }
-        }
-    } else if (c == 2) {
-        printf("Enter name or substring (case-insensitive): ");
-        char q[200];
-        safe_fgets(q, sizeof(q));
-        for (int i = 0; q[i]; ++i) q[i] = tolower((unsigned char)q[i]);
-        while (fread(&s, sizeof(Student), 1, fp) == 1) {
-            char nm[MAX_NAME_LEN];
-            strncpy(nm, s.name, sizeof(nm));
-            for (int i = 0; nm[i]; ++i) nm[i] = tolower((unsigned char)nm[i]);
-            if (strstr(nm, q)) {
-                if (!found) printf(COL_GREEN "Matching students:\n" COL_RESET);
-                print_student_row(&s);
-                found = 1;
-            }
-        }
-    } else if (c == 3) {
-        printf("Enter grade (A/B/C/D/F): ");
-        char g = getchar();
-        while (getchar() != '\n');
-        if (g >= 'a' && g <= 'z') g = toupper(g);
-        while (fread(&s, sizeof(Student), 1, fp) == 1) {
-            if (s.grade == g) {
-                if (!found) printf(COL_GREEN "Matching students:\n" COL_RESET);
-                print_student_row(&s);
-                found = 1;
-            }
-        }
-    } else {
-        printf("Invalid choice.\n");
+WireReply *reply_header(ReplyBuf *r) { return (WireReply *)r->buf; }
+
+int reply_put(ReplyBuf *r, const void *p, size_t n) {
+    if (r->len + n > r->cap) {
+        size_t cap = r->cap ? r->cap : 4096;
+        while (cap < r->len + n) cap *= 2;
+        unsigned char *b = realloc(r->buf, cap);
+        if (!b) return 0;
+        r->buf = b;
+        r->cap = cap;
     }
+    memcpy(r->buf + r->len, p, n);
+    r->len += n;
+    return 1;
+}
 
-    if (!found) printf(COL_RED "No matching records found.\n" COL_RESET);
-    fclose(fp);
-    pause_anykey();
+void reply_records(ReplyBuf *r, const StudentRec **recs, int n) {
+    for (int i = 0; i < n; ++i) {
+        if (!reply_put(r, recs[i], RECORD_SIZE)) { reply_header(r)->status = OP_IO_ERROR; return; }
+        reply_header(r)->count++;
+    }
 }
 
-// -------- UPDATE --------
-void update_feature() {
-    printf("Enter roll number to update: ");
-    int r;
-    if (scanf("%d", &r) != 1) { printf("Invalid input.\n"); while (getchar()!='\n'); pause_anykey(); return; }
-    while (getchar() != '\n');
+// Everything data_view() and the sidecars are checked against: the data
+// stamp, DATA_FILE itself (the snapshot, with the log engine) and how far
+// LOG_FILE reaches.
+typedef struct {
+    DataStamp data;
+    DataStamp file;
+    int64_t log_size;
+} ViewStamp;
 
-    FILE *fp = fopen(DATA_FILE, "rb");
-    if (!fp) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
-    FILE *temp = fopen("temp.dat", "wb");
-    if (!temp) { fclose(fp); printf(COL_RED "Error creating temp file.\n" COL_RESET); pause_anykey(); return; }
+ViewStamp view_stamp() {
+    ViewStamp s;
+    DataStamp log;
+    data_file_stamp(&s.data);
+    file_stamp(DATA_FILE, &s.file);
+    file_stamp(LOG_FILE, &log);
+    s.log_size = g_storage_log ? log.size : 0;
+    return s;
+}
 
-    Student s;
-    int found = 0;
-    while (fread(&s, sizeof(Student), 1, fp) == 1) {
-        if (s.rollNo == r) {
-            found = 1;
-            printf("Current name: %s\n", s.name);
-            printf("Enter new name (leave blank to keep): ");
-            char newname[MAX_NAME_LEN];
-            safe_fgets(newname, sizeof(newname));
-            if (strlen(newname) > 0) { strncpy(s.name, newname, sizeof(s.name)); to_titlecase(s.name); }
-            for (int i = 0; i < SUBJECT_COUNT; ++i) {
-                printf("Current marks for %s: %.2f\n", SUBJECT_NAMES[i], s.marks[i]);
-                printf("Enter new marks (or -1 to keep): ");
-                float m;
-                if (scanf("%f", &m) != 1) { while (getchar()!='\n'); printf("Invalid input, keeping old.\n"); continue; }
-                if (m >= 0.0f) s.marks[i] = m;
-            }
-            while (getchar() != '\n');
-            recalc_student(&s);
-            printf(COL_GREEN "Record updated.\n" COL_RESET);
-        }
-        fwrite(&s, sizeof(Student), 1, temp);
+int view_stamp_equal(ViewStamp a, ViewStamp b) {
+    return stamp_equal(a.data, b.data) && stamp_equal(a.file, b.file) && a.log_size == b.log_size;
+}
+
+pthread_rwlock_t g_db_lock = PTHREAD_RWLOCK_INITIALIZER;
+ViewStamp g_db_stamp;              // data the caches were last made fresh for
+volatile sig_atomic_t g_daemon_stop = 0;
+
+// Build or refresh everything readers would otherwise build lazily, then
+// pin the view: readers share it under the read lock, so only a writer may
+// replace it. Called with the write lock held.
+void daemon_prepare() {
+    g_view_pinned = 0;
+    StudentView v;
+    data_view(&v);
+    IndexHeader ih;
+    FILE *fp = index_open(&ih, 1);
+    if (fp) fclose(fp);
+    TriHeader th;
+    if ((fp = tri_open(&th, 1))) fclose(fp);
+    gbm_get();
+    ClassStats st;
+    class_stats(&st); // folds pending extremes in, so readers never need the columns
+    g_db_stamp = view_stamp();
+    g_view_pinned = 1;
+}
+
+void daemon_read_lock() {
+    pthread_rwlock_rdlock(&g_db_lock);
+    while (!view_stamp_equal(view_stamp(), g_db_stamp)) { // changed behind our back
+        pthread_rwlock_unlock(&g_db_lock);
+        pthread_rwlock_wrlock(&g_db_lock);
+        daemon_prepare();
+        pthread_rwlock_unlock(&g_db_lock);
+        pthread_rwlock_rdlock(&g_db_lock);
     }
-    fclose(fp);
-    fclose(temp);
-    remove(DATA_FILE);
-    rename("temp.dat", DATA_FILE);
-    if (!found) printf(COL_RED "Roll number not found.\n" COL_RESET);
-    pause_anykey();
 }
 
-// -------- DELETE --------
-void delete_feature() {
-    printf("Enter roll number to delete: ");
-    int r;
-    if (scanf("%d", &r) != 1) { printf("Invalid input.\n"); while (getchar()!='\n'); pause_anykey(); return; }
-    while (getchar() != '\n');
+// Copy a NUL-terminated string of at most max-1 bytes out of the payload.
+int wire_text(const unsigned char *p, uint32_t len, char *out, size_t max) {
+    if (len >= max) return 0;
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return 1;
+}
 
-    FILE *fp = fopen(DATA_FILE, "rb");
-    if (!fp) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
-    FILE *temp = fopen("temp.dat", "wb");
-    if (!temp) { fclose(fp); printf(COL_RED "Error creating temp file.\n" COL_RESET); pause_anykey(); return; }
+void daemon_read(const WireRequest *q, const unsigned char *p, ReplyBuf *r) {
+    WireReply *h = reply_header(r);
+    int32_t arg = 0;
+    if (q->len == sizeof(arg)) memcpy(&arg, p, sizeof(arg));
+    char text[2 * MAX_NAME_LEN + 16];
+    int n = 0;
+    const StudentRec **recs = NULL;
+    switch (q->op) {
+    case REQ_GET: {
+        if (q->len != sizeof(arg)) { h->status = OP_BAD_REQUEST; return; }
+        const StudentRec *rec = find_by_roll(arg);
+        if (rec) reply_records(r, &rec, 1);
+        else h->status = OP_NOT_FOUND;
+        return;
+    }
+    case REQ_SEARCH_NAME:
+        if (!wire_text(p, q->len, text, sizeof(text))) { h->status = OP_BAD_REQUEST; return; }
+        recs = find_by_name(text, &n);
+        break;
+    case REQ_SEARCH_GRADE: { // grades NUL [name]
+        if (!wire_text(p, q->len, text, sizeof(text))) { h->status = OP_BAD_REQUEST; return; }
+        size_t gl = strlen(text);
+        const char *name = gl < q->len && text[gl + 1] ? text + gl + 1 : NULL;
+        recs = find_by_grade(text, name, &n);
+        break;
+    }
+    case REQ_RANK:
+        if (q->len != sizeof(arg)) { h->status = OP_BAD_REQUEST; return; }
+        recs = rank_top_k(arg, &n);
+        break;
+    case REQ_ANALYTICS: {
+        AnalyticsSummary a;
+        if (!analytics_summary(&a)) h->status = OP_NOT_FOUND;
+        else if (!reply_put(r, &a, sizeof(a))) reply_header(r)->status = OP_IO_ERROR;
+        return;
+    }
+    }
+    h = reply_header(r);
+    if (n == 0) h->status = OP_NOT_FOUND;
+    reply_records(r, recs, n);
+    free(recs);
+}
 
+void daemon_write(const WireRequest *q, const unsigned char *p, ReplyBuf *r) {
     Student s;
-    int found = 0;
-    while (fread(&s, sizeof(Student), 1, fp) == 1) {
-        if (s.rollNo == r) {
-            found = 1;
-            printf(COL_GREEN "Record deleted for roll %d\n" COL_RESET, r);
+    int rc;
+    if (q->op == REQ_DELETE) {
+        int32_t roll;
+        if (q->len != sizeof(roll)) { reply_header(r)->status = OP_BAD_REQUEST; return; }
+        memcpy(&roll, p, sizeof(roll));
+        reply_header(r)->status = delete_student(roll, NULL);
+        return;
+    }
+    if (q->len != (uint32_t)RECORD_SIZE) { reply_header(r)->status = OP_BAD_REQUEST; return; }
+    uint32_t buf[MAX_RECORD_SIZE / sizeof(uint32_t)];
+    memcpy(buf, p, RECORD_SIZE);
+    rec_to_student((const StudentRec *)buf, SUBJECT_COUNT, &s);
+    s.name[sizeof(s.name) - 1] = '\0';
+    rc = q->op == REQ_ADD ? add_student(&s) : update_student(&s);
+    reply_header(r)->status = rc;
+    const StudentRec *rec = rc == OP_OK ? find_by_roll(s.rollNo) : NULL;
+    if (rec) reply_records(r, &rec, 1);
+}
+
+void *daemon_connection(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    unsigned char payload[WIRE_MAX_REQUEST];
+    ReplyBuf r = { NULL, 0, 0 };
+    WireRequest q;
+    while (wire_read_all(fd, &q, sizeof(q))) {
+        if (q.len > sizeof(payload) || !wire_read_all(fd, payload, q.len)) break;
+        WireReply empty = { OP_OK, 0, (uint32_t)RECORD_SIZE, 0 };
+        r.len = 0;
+        if (!reply_put(&r, &empty, sizeof(empty))) break;
+        if (q.op >= REQ_ADD && q.op <= REQ_DELETE) {
+            pthread_rwlock_wrlock(&g_db_lock);
+            g_view_pinned = 0; // write against DATA_FILE as it is now
+            daemon_write(&q, payload, &r);
+            daemon_prepare();
+            pthread_rwlock_unlock(&g_db_lock);
+        } else if (q.op >= REQ_GET && q.op <= REQ_ANALYTICS) {
+            daemon_read_lock();
+            daemon_read(&q, payload, &r);
+            pthread_rwlock_unlock(&g_db_lock);
         } else {
-            fwrite(&s, sizeof(Student), 1, temp);
+            reply_header(&r)->status = OP_BAD_REQUEST;
         }
+        reply_header(&r)->len = (uint32_t)(r.len - sizeof(WireReply));
+        if (!wire_write_all(fd, r.buf, r.len)) break;
     }
-    fclose(fp);
-    fclose(temp);
-    remove(DATA_FILE);
-    rename("temp.dat", DATA_FILE);
-    if (!found) printf(COL_RED "Roll number not found.\n" COL_RESET);
-    pause_anykey();
+    free(r.buf);
+    close(fd);
+    return NULL;
 }
 
-// -------- BACKUP & RESTORE --------
-void backup_data() {
-    FILE *src = fopen(DATA_FILE, "rb");
-    if (!src) { printf(COL_RED "No data to backup.\n" COL_RESET); pause_anykey(); return; }
-    FILE *dst = fopen(BACKUP_FILE, "wb");
-    if (!dst) { fclose(src); printf(COL_RED "Cannot create backup file.\n" COL_RESET); pause_anykey(); return; }
-    char buf[4096];
-    size_t r;
-    while ((r = fread(buf, 1, sizeof(buf), src)) > 0) fwrite(buf, 1, r, dst);
-    fclose(src); fclose(dst);
-    printf(COL_GREEN "Backup saved to %s\n" COL_RESET, BACKUP_FILE);
-    pause_anykey();
+void daemon_on_signal(int sig) { (void)sig; g_daemon_stop = 1; }
+
+int socket_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) return 0;
+    strcpy(addr->sun_path, path);
+    return 1;
 }
 
-void restore_data() {
-    FILE *src = fopen(BACKUP_FILE, "rb");
-    if (!src) { printf(COL_RED "Backup not found.\n" COL_RESET); pause_anykey(); return; }
-    FILE *dst = fopen(DATA_FILE, "wb");
-    if (!dst) { fclose(src); printf(COL_RED "Cannot restore (permission?).\n" COL_RESET); pause_anykey(); return; }
-    char buf[4096];
-    size_t r;
-    while ((r = fread(buf, 1, sizeof(buf), src)) > 0) fwrite(buf, 1, r, dst);
-    fclose(src); fclose(dst);
-    printf(COL_GREEN "Data restored from backup.\n" COL_RESET);
-    pause_anykey();
+int daemon_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (!socket_address(path, &addr)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) { close(fd); fd = -1; }
+    return fd;
 }
 
-// -------- REPORT CARD GENERATION --------
-void generate_report(int roll) {
-    FILE *fp = fopen(DATA_FILE, "rb");
-    if (!fp) { printf(COL_RED "No data file.\n" COL_RESET); pause_anykey(); return; }
-    Student s;
-    int found = 0;
-    while (fread(&s, sizeof(Student), 1, fp) == 1) {
-        if (s.rollNo == roll) { found = 1; break; }
+// Serve requests on path until SIGINT/SIGTERM. Returns the exit status.
+int daemon_serve(const char *path) {
+    struct sockaddr_un addr;
+    if (!socket_address(path, &addr)) { fprintf(stderr, "socket path too long\n"); return 1; }
+    int probe = daemon_connect(path);
+    if (probe >= 0) { close(probe); fprintf(stderr, "a daemon is already serving %s\n", path); return 1; }
+    unlink(path); // left over from a daemon that did not shut down
+    int ls = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (ls < 0 || bind(ls, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(ls, 128) != 0) {
+        fprintf(stderr, "cannot listen on %s\n", path);
+        if (ls >= 0) close(ls);
+        return 1;
     }
-    fclose(fp);
-    if (!found) { printf(COL_RED "Student not found.\n" COL_RESET); pause_anykey(); return; }
-    ensure_reports_dir();
-    char fname[256];
-    snprintf(fname, sizeof(fname), "%s/report_roll_%d.txt", REPORTS_DIR, roll);
-    FILE *rp = fopen(fname, "w");
-    if (!rp) { printf(COL_RED "Cannot create report file.\n" COL_RESET); pause_anykey(); return; }
-    fprintf(rp, "----- Report Card -----\n");
-    fprintf(rp, "Roll Number: %d\n", s.rollNo);
-    fprintf(rp, "Name: %s\n", s.name);
-    for (int i = 0; i < SUBJECT_COUNT; ++i) {
-        fprintf(rp, "%-12s : %.2f\n", SUBJECT_NAMES[i], s.marks[i]);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemon_on_signal; // no SA_RESTART: accept() returns EINTR
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+#ifdef __linux__
+    pthread_rwlockattr_t attr; // a steady stream of readers must not starve writers
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&g_db_lock, &attr);
+#endif
+    pthread_rwlock_wrlock(&g_db_lock);
+    daemon_prepare();
+    pthread_rwlock_unlock(&g_db_lock);
+    printf("listening\t%s\n", path);
+    fflush(stdout);
+    while (!g_daemon_stop) {
+        int fd = accept(ls, NULL, NULL);
+        if (fd < 0) { if (errno == EINTR || errno == ECONNABORTED) continue; break; }
+        pthread_t t;
+        if (pthread_create(&t, NULL, daemon_connection, (void *)(intptr_t)fd) != 0) { close(fd); continue; }
+        pthread_detach(t);
     }
-    fprintf(rp, "Total       : %.2f\n", s.total);
-    fprintf(rp, "Percentage  : %.2f\n", s.percentage);
-    fprintf(rp, "Grade       : %c\n", s.grade);
-    fprintf(rp, "Generated on: %s", ctime(&(time_t){time(NULL)}));
-    fclose(rp);
-    printf(COL_GREEN "Report generated: %s\n" COL_RESET, fname);
-    pause_anykey();
+    close(ls);
+    unlink(path);
+    pthread_rwlock_wrlock(&g_db_lock); // let a write in progress finish; keep new ones out
+    return 0;
 }
 
-void generate_report_for_student_feature() {
-    printf("Enter roll number to generate report: ");
-    int r;
-    if (scanf("%d", &r) != 1) { printf("Invalid input.\n"); while (getchar()!='\n'); pause_anykey(); return; }
-    while (getchar() != '\n');
-    generate_report(r);
+// One request/reply round trip. *body (malloc'd) receives the payload.
+int daemon_call(int fd, int op, const void *payload, uint32_t len, WireReply *h, unsigned char **body) {
+    WireRequest q = { (uint8_t)op, {0, 0, 0}, len };
+    unsigned char msg[sizeof(WireRequest) + WIRE_MAX_REQUEST];
+    if (len > WIRE_MAX_REQUEST) return 0;
+    memcpy(msg, &q, sizeof(q));
+    memcpy(msg + sizeof(q), payload, len);
+    *body = NULL;
+    if (!wire_write_all(fd, msg, sizeof(q) + len) || !wire_read_all(fd, h, sizeof(*h))) return 0;
+    *body = malloc(h->len ? h->len : 1);
+    return *body && wire_read_all(fd, *body, h->len);
 }
 
-// -------- STATISTICS & ANALYTICS --------
-void analytics_feature() {
-    int count = 0;
-    Student *arr = load_all_students(&count);
-    if (!arr) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
-    clear_screen();
-    printf(COL_CYAN "----- Analytics & Statistics -----\n" COL_RESET);
-    float class_total = 0.0f;
-    float subj_totals[MAX_SUBJECTS] = {0};
-    float subj_max[MAX_SUBJECTS]; for (int i=0;i<MAX_SUBJECTS;++i) subj_max[i] = -1.0f;
-    int subj_topper_idx[MAX_SUBJECTS]; for (int i=0;i<MAX_SUBJECTS;++i) subj_topper_idx[i] = -1;
-    float highest = -1.0f; int highest_idx = -1;
-    float lowest = 1e9; int lowest_idx = -1;
-    int grade_counts[5] = {0}; // A,B,C,D,F
+// Encode the request for a CLI-style command line. Returns 0 on success or
+// the exit status for bad usage.
+int client_request(int argc, char **argv, int *op, unsigned char *payload, uint32_t *len) {
+    const char *cmd = argv[0];
+    int32_t arg;
+    Student s;
+    *len = 0;
+    if ((strcmp(cmd, "get") == 0 || strcmp(cmd, "delete") == 0) && argc == 2 && cli_parse_int(argv[1], &arg)) {
+        *op = cmd[0] == 'g' ? REQ_GET : REQ_DELETE;
+    } else if (strcmp(cmd, "rank") == 0 && argc <= 2) {
+        arg = -1;
+        if (argc == 2 && (!cli_parse_int(argv[1], &arg) || arg < 0)) { cli_usage(); return 1; }
+        *op = REQ_RANK;
+    } else if (strcmp(cmd, "analytics") == 0 && argc == 1) {
+        *op = REQ_ANALYTICS;
+        return 0;
+    } else if (strcmp(cmd, "search") == 0 && argc == 3 && strcmp(argv[1], "name") == 0) {
+        *op = REQ_SEARCH_NAME;
+        *len = (uint32_t)strlen(argv[2]);
+        if (*len >= 2 * MAX_NAME_LEN) { cli_usage(); return 1; }
+        memcpy(payload, argv[2], *len);
+        return 0;
+    } else if (strcmp(cmd, "search") == 0 && (argc == 3 || argc == 4) && strcmp(argv[1], "grade") == 0) {
+        *op = REQ_SEARCH_GRADE;
+        int n = snprintf((char *)payload, 2 * MAX_NAME_LEN, "%s%c%s", argv[2], 0, argc == 4 ? argv[3] : "");
+        if (n >= 2 * MAX_NAME_LEN) { cli_usage(); return 1; }
+        *len = (uint32_t)n;
+        return 0;
+    } else if (strcmp(cmd, "add") == 0 || strcmp(cmd, "update") == 0) {
+        int bad = cli_parse_student(argc, argv, &s);
+        if (bad) return bad;
+        *op = cmd[0] == 'a' ? REQ_ADD : REQ_UPDATE;
+        student_to_rec(&s, (StudentRec *)payload);
+        *len = (uint32_t)RECORD_SIZE;
+        return 0;
+    } else {
+        cli_usage();
+        return 1;
+    }
+    memcpy(payload, &arg, sizeof(arg));
+    *len = sizeof(arg);
+    return 0;
+}
 
-    for (int i = 0; i < count; ++i) {
-        class_total += arr[i].percentage;
-        if (arr[i].percentage > highest) { highest = arr[i].percentage; highest_idx = i; }
-        if (arr[i].percentage < lowest) { lowest = arr[i].percentage; lowest_idx = i; }
-        for (int j = 0; j < SUBJECT_COUNT; ++j) {
-            subj_totals[j] += arr[i].marks[j];
-            if (arr[i].marks[j] > subj_max[j]) { subj_max[j] = arr[i].marks[j]; subj_topper_idx[j] = i; }
+// g1 client [--socket path] <command> [args]: run one command on the
+// daemon, printing what the same headless command would print.
+int client_main(int argc, char **argv) {
+    const char *path = SOCKET_FILE;
+    int a = 2;
+    if (argc > 3 && strcmp(argv[2], "--socket") == 0) { path = argv[3]; a = 4; }
+    if (a >= argc) { cli_usage(); return 1; }
+    int op;
+    uint32_t len;
+    uint32_t payload[WIRE_MAX_REQUEST / sizeof(uint32_t)];
+    int bad = client_request(argc - a, argv + a, &op, (unsigned char *)payload, &len);
+    if (bad) return bad;
+    int fd = daemon_connect(path);
+    if (fd < 0) { fprintf(stderr, "no daemon at %s (start one with: g1 serve)\n", path); return 1; }
+    WireReply h;
+    unsigned char *body;
+    int ok = daemon_call(fd, op, payload, len, &h, &body);
+    close(fd);
+    if (!ok) { free(body); fprintf(stderr, "daemon connection lost\n"); return 1; }
+    if (op == REQ_ANALYTICS && h.status == OP_OK && h.len == sizeof(AnalyticsSummary)) {
+        AnalyticsSummary s;
+        memcpy(&s, body, sizeof(s));
+        cli_print_analytics(&s);
+    } else if (h.count > 0 && h.rec_size != (uint32_t)RECORD_SIZE) {
+        h.status = OP_BAD_REQUEST;
+        fprintf(stderr, "daemon uses a different subject configuration\n");
+    } else {
+        uint32_t rec[MAX_RECORD_SIZE / sizeof(uint32_t)];
+        for (uint32_t i = 0; i < h.count; ++i) {
+            memcpy(rec, body + (size_t)i * h.rec_size, h.rec_size);
+            if (op == REQ_RANK) printf("%u\t", i + 1);
+            cli_print_record((const StudentRec *)rec);
         }
-        if (arr[i].grade == 'A') grade_counts[0]++;
-        else if (arr[i].grade == 'B') grade_counts[1]++;
-        else if (arr[i].grade == 'C') grade_counts[2]++;
-        else if (arr[i].grade == 'D') grade_counts[3]++;
-        else grade_counts[4]++;
     }
+    free(body);
+    if (h.status == OP_DUPLICATE) { fprintf(stderr, "roll already exists\n"); return 2; }
+    if (h.status == OP_NOT_FOUND) {
+        if (op == REQ_GET || op == REQ_DELETE) fprintf(stderr, "roll %s not found\n", argv[a + 1]);
+        else if (op == REQ_ANALYTICS) fprintf(stderr, "no records\n");
+        return 2;
+    }
+    if (h.status != OP_OK) { fprintf(stderr, "request failed (status %d)\n", h.status); return 1; }
+    return 0;
+}
 
-    printf("Class size: %d\n", count);
-    printf("Class average percentage: %.2f\n", class_total / count);
-    if (highest_idx >= 0) printf("Topper (overall): %s (Roll %d) - %.2f%%\n", arr[highest_idx].name, arr[highest_idx].rollNo, arr[highest_idx].percentage);
-    if (lowest_idx >= 0) printf("Lowest (overall): %s (Roll %d) - %.2f%%\n", arr[lowest_idx].name, arr[lowest_idx].rollNo, arr[lowest_idx].percentage);
+typedef struct {
+    const char *path;
+    const unsigned char *recs; // sample of the dataset to draw requests from
+    int nrecs;
+    int writes;               // percent of requests that are updates
+    double deadline;
+    unsigned seed;
+    int64_t *lat_ns;          // per-request latencies
+    int count, cap, errors;
+} LoadWorker;
 
-    printf("\nSubject-wise toppers:\n");
-    for (int j = 0; j < SUBJECT_COUNT; ++j) {
-        if (subj_topper_idx[j] >= 0)
-            printf(" %s : %s (Roll %d) - %.2f\n", SUBJECT_NAMES[j], arr[subj_topper_idx[j]].name, arr[subj_topper_idx[j]].rollNo, subj_max[j]);
+void *loadgen_worker(void *arg) {
+    LoadWorker *w = arg;
+    int fd = daemon_connect(w->path);
+    if (fd < 0) { w->errors++; return NULL; }
+    unsigned char payload[WIRE_MAX_REQUEST];
+    while (monotonic_seconds() < w->deadline) {
+        const StudentRec *s = (const StudentRec *)(w->recs + (size_t)(rand_r(&w->seed) % w->nrecs) * RECORD_SIZE);
+        int pick = rand_r(&w->seed) % 100, op;
+        uint32_t len = sizeof(int32_t);
+        if (pick < w->writes) { // rewrite a record with its own values
+            op = REQ_UPDATE;
+            memcpy(payload, s, RECORD_SIZE);
+            len = (uint32_t)RECORD_SIZE;
+        } else if ((pick = rand_r(&w->seed) % 100) < 70) {
+            op = REQ_GET;
+            memcpy(payload, &s->rollNo, sizeof(int32_t));
+        } else if (pick < 95) { // the end of a real name, alone or with its grade
+            size_t nl = strlen(s->name), take = nl < 6 ? nl : 6, at = 0;
+            if (pick < 85) {
+                op = REQ_SEARCH_NAME;
+            } else {
+                op = REQ_SEARCH_GRADE;
+                payload[0] = s->grade;
+                payload[1] = '\0';
+                at = 2;
+            }
+            memcpy(payload + at, s->name + nl - take, take);
+            len = (uint32_t)(at + take);
+        } else if (pick < 98) {
+            op = REQ_RANK;
+            int32_t k = 10;
+            memcpy(payload, &k, sizeof(k));
+        } else {
+            op = REQ_ANALYTICS;
+            len = 0;
+        }
+        WireReply h;
+        unsigned char *body;
+        double t0 = monotonic_seconds();
+        int ok = daemon_call(fd, op, payload, len, &h, &body);
+        double t1 = monotonic_seconds();
+        free(body);
+        if (!ok) { w->errors++; break; }
+        if (h.status != OP_OK && h.status != OP_NOT_FOUND) w->errors++;
+        if (w->count == w->cap) {
+            int cap = w->cap ? w->cap * 2 : 4096;
+            int64_t *l = realloc(w->lat_ns, sizeof(int64_t) * cap);
+            if (!l) break;
+            w->lat_ns = l;
+            w->cap = cap;
+        }
+        w->lat_ns[w->count++] = (int64_t)((t1 - t0) * 1e9);
     }
+    close(fd);
+    return NULL;
+}
 
-    printf("\nGrade distribution:\n");
-    printf(" A: %d\n B: %d\n C: %d\n D: %d\n F: %d\n", grade_counts[0], grade_counts[1], grade_counts[2], grade_counts[3], grade_counts[4]);
+// g1 loadgen [--socket path] [--clients N] [--seconds S] [--writes PCT]:
+// N connections issuing a read-mostly mix against the daemon as fast as
+// it answers; prints throughput and latency percentiles.
+int loadgen_main(int argc, char **argv) {
+    const char *path = SOCKET_FILE;
+    int clients = 8, seconds = 5, writes = 0;
+    for (int i = 2; i < argc; i += 2) {
+        int *target = strcmp(argv[i], "--clients") == 0 ? &clients : strcmp(argv[i], "--seconds") == 0 ? &seconds :
+                      strcmp(argv[i], "--writes") == 0 ? &writes : NULL;
+        if (i + 1 < argc && strcmp(argv[i], "--socket") == 0) { path = argv[i + 1]; continue; }
+        if (!target || i + 1 >= argc || !cli_parse_int(argv[i + 1], target)) { cli_usage(); return 1; }
+    }
+    if (clients < 1 || clients > LOADGEN_MAX_CLIENTS || seconds < 1 || writes < 0 || writes > 100) { cli_usage(); return 1; }
+    // The whole ranking doubles as a sample of real rolls and names.
+    int fd = daemon_connect(path);
+    if (fd < 0) { fprintf(stderr, "no daemon at %s (start one with: g1 serve)\n", path); return 1; }
+    int32_t all = 0;
+    WireReply h;
+    unsigned char *sample;
+    int ok = daemon_call(fd, REQ_RANK, &all, sizeof(all), &h, &sample);
+    close(fd);
+    if (!ok || h.status != OP_OK || h.count == 0 || h.rec_size != (uint32_t)RECORD_SIZE) {
+        free(sample);
+        fprintf(stderr, "cannot load a sample of records from the daemon\n");
+        return 1;
+    }
+    LoadWorker w[LOADGEN_MAX_CLIENTS];
+    pthread_t t[LOADGEN_MAX_CLIENTS];
+    double start = monotonic_seconds();
+    for (int i = 0; i < clients; ++i) {
+        w[i] = (LoadWorker){ path, sample, (int)h.count, writes, start + seconds, 12345u + i, NULL, 0, 0, 0 };
+        if (pthread_create(&t[i], NULL, loadgen_worker, &w[i]) != 0) { clients = i; break; }
+    }
+    long total = 0, errors = 0;
+    for (int i = 0; i < clients; ++i) { pthread_join(t[i], NULL); total += w[i].count; errors += w[i].errors; }
+    double elapsed = monotonic_seconds() - start;
+    int64_t *lat = malloc(sizeof(int64_t) * (total ? total : 1));
+    long k = 0;
+    for (int i = 0; i < clients; ++i) {
+        if (lat) memcpy(lat + k, w[i].lat_ns, sizeof(int64_t) * w[i].count);
+        k += w[i].count;
+        free(w[i].lat_ns);
+    }
+    free(sample);
+    printf("clients\t%d\nrequests\t%ld\nerrors\t%ld\nseconds\t%.2f\nrps\t%.0f\n", clients, total, errors, elapsed, total / elapsed);
+    if (lat && total > 0) {
+        qsort(lat, (size_t)total, sizeof(int64_t), compare_i64);
+        const double q[] = { 50, 90, 99, 99.9 };
+        const char *name[] = { "p50", "p90", "p99", "p99.9" };
+        for (int i = 0; i < 4; ++i) printf("%s_us\t%.1f\n", name[i], lat[(long)((total - 1) * q[i] / 100)] / 1e3);
+        printf("max_us\t%.1f\n", lat[total - 1] / 1e3);
+    }
+    free(lat);
+    return errors ? 1 : 0;
+}
+#endif
 
-    free(arr);
-    pause_anykey();
+int cli_main(int argc, char **argv) {
+    if (strcmp(argv[1], "--stats") == 0) { // print this run's metrics on exit
+        if (argc < 3) { cli_usage(); return 1; }
+        g_metrics_dump = 1;
+        argv[1] = argv[0];
+        argc--;
+        argv++;
+    }
+    atexit(metrics_at_exit);
+    const char *cmd = argv[1];
+    if (strcmp(cmd, "stats") == 0) {
+        if (argc > 3 || (argc == 3 && strcmp(argv[2], "--reset") != 0)) { cli_usage(); return 1; }
+        if (argc == 3) { remove(METRICS_FILE); return 0; }
+        Metrics *m = calloc(1, sizeof(*m));
+        if (!m) return 1;
+        metrics_load(m);
+        metrics_print(stdout, m, 1);
+        free(m);
+        return 0;
+    }
+    load_subjects();
+#ifndef _WIN32
+    set_record_layout(); // clients never open DATA_FILE
+    if (strcmp(cmd, "client") == 0) return client_main(argc, argv);
+    if (strcmp(cmd, "loadgen") == 0) return loadgen_main(argc, argv);
+#endif
+    if (strcmp(cmd, "bench") == 0) return bench_main(argc, argv); // works in its own directory
+    load_storage_mode();
+    data_file_open_check();
+    log_recover();
+    journal_recover();
+    atexit(journal_flush_at_exit);
+
+#ifndef _WIN32
+    if (strcmp(cmd, "serve") == 0) {
+        if (argc > 3) { cli_usage(); return 1; }
+        return daemon_serve(argc == 3 ? argv[2] : SOCKET_FILE);
+    }
+#endif
+    if (strcmp(cmd, "add") == 0) {
+        Student s;
+        int bad = cli_parse_student(argc - 1, argv + 1, &s);
+        if (bad) return bad;
+        int rc = add_student(&s);
+        if (rc == OP_DUPLICATE) { fprintf(stderr, "roll %d already exists\n", s.rollNo); return 2; }
+        if (rc != OP_OK) { fprintf(stderr, "error writing %s\n", DATA_FILE); return 1; }
+        const StudentRec *r = find_by_roll(s.rollNo);
+        if (r) cli_print_record(r);
+        return 0;
+    }
+    if (strcmp(cmd, "get") == 0) {
+        int roll;
+        if (argc != 3 || !cli_parse_int(argv[2], &roll)) { cli_usage(); return 1; }
+        const StudentRec *r = find_by_roll(roll);
+        if (!r) { fprintf(stderr, "roll %d not found\n", roll); return 2; }
+        cli_print_record(r);
+        return 0;
+    }
+    if (strcmp(cmd, "search") == 0) {
+        if (argc < 4 || argc > 5) { cli_usage(); return 1; }
+        int n = 0;
+        const StudentRec **matches;
+        if (strcmp(argv[2], "name") == 0 && argc == 4) matches = find_by_name(argv[3], &n);
+        else if (strcmp(argv[2], "grade") == 0) matches = find_by_grade(argv[3], argc == 5 ? argv[4] : NULL, &n);
+        else { cli_usage(); return 1; }
+        for (int i = 0; i < n; ++i) cli_print_record(matches[i]);
+        free(matches);
+        return n > 0 ? 0 : 2;
+    }
+    if (strcmp(cmd, "rank") == 0) {
+        int k = -1;
+        if (argc > 3 || (argc == 3 && (!cli_parse_int(argv[2], &k) || k < 0))) { cli_usage(); return 1; }
+        int n = 0;
+        const StudentRec **arr = rank_top_k(k, &n);
+        for (int i = 0; i < n; ++i) { printf("%d\t", i + 1); cli_print_record(arr[i]); }
+        free(arr);
+        return n > 0 ? 0 : 2;
+    }
+    if (strcmp(cmd, "analytics") == 0) {
+        AnalyticsSummary a;
+        if (!analytics_summary(&a)) { fprintf(stderr, "no records\n"); return 2; }
+        cli_print_analytics(&a);
+        return 0;
+    }
+    if (strcmp(cmd, "distribution") == 0) {
+        int approx = 0, histogram = 0;
+        for (int i = 2; i < argc; ++i) {
+            if (strcmp(argv[i], "--approx") == 0) approx = 1;
+            else if (strcmp(argv[i], "--histogram") == 0) histogram = 1;
+            else { cli_usage(); return 1; }
+        }
+        Distribution d[DIST_COLUMNS];
+        int ncols = distribution_get(d, &approx);
+        if (ncols < 0) { fprintf(stderr, "out of memory\n"); return 1; }
+        if (ncols == 0) { fprintf(stderr, "no records\n"); return 2; }
+        if (approx) printf("# approximate (KLL, k=%d)\n", KLL_K);
+        else printf("# exact\n");
+        printf("column");
+        if (histogram) for (int b = 0; b < DIST_BINS; ++b) printf("\t%d-%d", b * 10, b == DIST_BINS - 1 ? 100 : b * 10 + 9);
+        else {
+            printf("\tcount\tmean\tstddev\tmin");
+            for (int i = 0; i < DIST_QUANTILES; ++i) printf("\t%s", DIST_Q_NAMES[i]);
+            printf("\tmax");
+        }
+        printf("\n");
+        for (int c = 0; c < ncols; ++c) {
+            printf("%s", c == 0 ? "percentage" : SUBJECT_NAMES[c - 1]);
+            if (histogram) for (int b = 0; b < DIST_BINS; ++b) printf("\t%lld", (long long)d[c].hist[b]);
+            else {
+                printf("\t%lld\t%.2f\t%.2f\t%.2f", (long long)d[c].count, d[c].mean, d[c].stddev, d[c].min);
+                for (int i = 0; i < DIST_QUANTILES; ++i) printf("\t%.2f", d[c].q[i]);
+                printf("\t%.2f", d[c].max);
+            }
+            printf("\n");
+        }
+        return 0;
+    }
+    if (strcmp(cmd, "backup") == 0) {
+        int incremental = argc > 2 && strcmp(argv[2], "--incremental") == 0;
+        int compress = argc > 2 && strcmp(argv[2], "--compress") == 0;
+        int flag = incremental || compress;
+        if (argc > 3 + flag) { cli_usage(); return 1; }
+        const char *path = argc == 3 + flag ? argv[2 + flag] : BACKUP_FILE;
+        int blocks = -1;
+        int rc = incremental ? backup_incremental(path, &blocks) : backup_to(path, compress);
+        if (rc == OP_NOT_FOUND) { fprintf(stderr, "no data to backup\n"); return 2; }
+        if (rc != OP_OK) { fprintf(stderr, "cannot write %s\n", path); return 1; }
+        if (blocks >= 0) printf("%s\tincremental\t%d\n", path, blocks);
+        else printf("%s\t%s\n", path, compress ? "compressed" : "full");
+        return 0;
+    }
+    if (strcmp(cmd, "restore") == 0) {
+        int upto = -1, arg = 2;
+        if (argc > 3 && strcmp(argv[2], "--upto") == 0) {
+            if (!cli_parse_int(argv[3], &upto) || upto < 0) { cli_usage(); return 1; }
+            arg = 4;
+        }
+        if (argc > arg + 1) { cli_usage(); return 1; }
+        const char *path = argc == arg + 1 ? argv[arg] : BACKUP_FILE;
+        int rc = restore_from(path, upto);
+        if (rc == OP_NOT_FOUND) { fprintf(stderr, "backup %s not found\n", path); return 2; }
+        if (rc != OP_OK) { fprintf(stderr, "cannot restore from %s\n", path); return 1; }
+        return 0;
+    }
+    if (strcmp(cmd, "report") == 0) {
+        int roll;
+        if (argc != 3 || !cli_parse_int(argv[2], &roll)) { cli_usage(); return 1; }
+        const StudentRec *r = find_by_roll(roll);
+        if (!r) { fprintf(stderr, "roll %d not found\n", roll); return 2; }
+        char fname[256];
+        if (write_report(r, fname, sizeof(fname)) != OP_OK) { fprintf(stderr, "cannot write report\n"); return 1; }
+        printf("%s\n", fname);
+        return 0;
+    }
+    if (strcmp(cmd, "gen") == 0) {
+        int records, subjects = SUBJECT_COUNT, seed = 1, force = 0;
+        if (argc < 3 || !cli_parse_int(argv[2], &records) || records < 1) { cli_usage(); return 1; }
+        for (int i = 3; i < argc; i += 2) {
+            if (strcmp(argv[i], "--force") == 0) { force = 1; --i; continue; }
+            int *target = strcmp(argv[i], "--subjects") == 0 ? &subjects : strcmp(argv[i], "--seed") == 0 ? &seed : NULL;
+            if (!target || i + 1 >= argc || !cli_parse_int(argv[i + 1], target)) { cli_usage(); return 1; }
+        }
+        if (subjects < 1 || subjects > MAX_SUBJECTS) { cli_usage(); return 1; }
+        int live, tombstones;
+        if (!force && index_counts(&live, &tombstones) && live > 0) {
+            fprintf(stderr, "%s already holds %d students (use --force to replace them)\n", DATA_FILE, live);
+            return 1;
+        }
+        double t0 = monotonic_seconds();
+        if (!generate_dataset(records, subjects, (uint64_t)seed)) { fprintf(stderr, "cannot write %s\n", DATA_FILE); return 1; }
+        printf("generated\t%d\t%.2f\n", records, monotonic_seconds() - t0);
+        return 0;
+    }
+    if (strcmp(cmd, "storage") == 0) {
+        if (argc > 3 || (argc == 3 && strcmp(argv[2], "file") != 0 && strcmp(argv[2], "log") != 0)) { cli_usage(); return 1; }
+        if (argc == 3 && !storage_set_mode(strcmp(argv[2], "log") == 0)) { fprintf(stderr, "cannot switch storage engine\n"); return 1; }
+        printf("storage\t%s\n", g_storage_log ? "log" : "file");
+        return 0;
+    }
+    if (strcmp(cmd, "checkpoint") == 0) {
+        if (argc != 2) { cli_usage(); return 1; }
+        if (!log_checkpoint()) { fprintf(stderr, "checkpoint failed\n"); return 1; }
+        return 0;
+    }
+    if (strcmp(cmd, "reports") == 0) {
+        ReportFilter f = { "", INT32_MIN, INT32_MAX };
+        for (int i = 2; i < argc; i += 2) {
+            if (i + 1 >= argc) { cli_usage(); return 1; }
+            if (strcmp(argv[i], "--grade") == 0) snprintf(f.grades, sizeof(f.grades), "%s", argv[i + 1]);
+            else if (strcmp(argv[i], "--from") == 0 && cli_parse_int(argv[i + 1], &f.roll_min)) continue;
+            else if (strcmp(argv[i], "--to") == 0 && cli_parse_int(argv[i + 1], &f.roll_max)) continue;
+            else { cli_usage(); return 1; }
+        }
+        int failed;
+        int n = generate_reports(&f, &failed);
+        if (n < 0) { fprintf(stderr, "no records\n"); return 2; }
+        printf("written\t%d\nfailed\t%d\n", n, failed);
+        return failed ? 1 : (n > 0 ? 0 : 2);
+    }
+    if (strcmp(cmd, "import") == 0 || strcmp(cmd, "--import") == 0) {
+        if (argc > 3) { cli_usage(); return 1; }
+        const char *path = argc == 3 ? argv[2] : "-";
+        FILE *in = strcmp(path, "-") == 0 ? stdin : io_fopen(path, "r");
+        if (!in) { fprintf(stderr, "cannot open %s\n", path); return 1; }
+        int rejected;
+        int n = import_students(in, &rejected);
+        if (in != stdin) fclose(in);
+        if (n < 0) { fprintf(stderr, "error writing %s\n", DATA_FILE); return 1; }
+        printf("imported\t%d\nrejected\t%d\n", n, rejected);
+        return rejected > 0 ? 2 : 0;
+    }
+    if (strcmp(cmd, "subjects") == 0) {
+        for (int i = 0; i < SUBJECT_COUNT; ++i) printf("%s\n", SUBJECT_NAMES[i]);
+        return 0;
+    }
+    cli_usage();
+    return strcmp(cmd, "help") == 0 ? 0 : 1;
 }
 
-// -------- TOPPER & RANKING --------
-void show_topper_and_ranking() {
-    int count = 0;
-    Student *arr = load_all_students(&count);
-    if (!arr) { printf(COL_RED "No records found.\n" COL_RESET); pause_anykey(); return; }
-    qsort(arr, count, sizeof(Student), compare_by_percentage_desc);
+// -------- OPERATION STATISTICS --------
+// Saved totals plus this session, which is folded in on exit.
+void stats_feature() {
     clear_screen();
-    printf(COL_CYAN "----- Class Ranking -----\n" COL_RESET);
-    display_table_header();
-    for (int i = 0; i < count; ++i) {
-        printf("%2d) ", i+1);
-        print_student_row(&arr[i]);
+    Metrics *m = calloc(1, sizeof(*m));
+    if (!m) { printf(COL_RED "Out of memory.\n" COL_RESET); pause_anykey(); return; }
+    metrics_load(m);
+    metrics_merge(m, &g_metrics);
+    printf(COL_CYAN "Operation statistics (all runs, latencies in microseconds)\n\n" COL_RESET);
+    metrics_print(stdout, m, 0);
+    free(m);
+    printf("\nReset saved statistics? (y/N): ");
+    char ans[8];
+    safe_fgets(ans, sizeof(ans));
+    if (ans[0] == 'y' || ans[0] == 'Y') {
+        remove(METRICS_FILE);
+        memset(&g_metrics, 0, sizeof(g_metrics));
+        printf(COL_GREEN "Statistics reset.\n" COL_RESET);
     }
-    if (count > 0) printf(COL_GREEN "\nTopper: %s (Roll %d) - %.2f%%\n" COL_RESET, arr[0].name, arr[0].rollNo, arr[0].percentage);
-    free(arr);
     pause_anykey();
 }
 
 // -------- MENU & MAIN LOOP --------
 void show_main_menu() {
-    printf(COL_BLUE "===== Student Result Management System - Full Version =====\n" COL_RESET);
-    printf("1. Add Student Record\n");
-    printf("2. Display All Records\n");
-    printf("3. Search Students\n");
-    printf("4. Update Student\n");
-    printf("5. Delete Student\n");
-    printf("6. Backup Data\n");
-    printf("7. Restore Data\n");
-    printf("8. Generate Report Card (single)\n");
-    printf("9. Analytics & Statistics\n");
-    printf("10. Show Topper & Ranking\n");
-    printf("11. Configure Subjects\n");
-    printf("12. Admin Menu (change password)\n");
-    printf("0. Exit\n");
-    printf(COL_YELLOW "Enter your choice: " COL_RESET);
+    fb_clear();
+    fb_printf(COL_BLUE "===== Student Result Management System - Full Version =====\n" COL_RESET);
+    fb_printf("1. Add Student Record\n");
+    fb_printf("2. Display All Records\n");
+    fb_printf("3. Search Students\n");
+    fb_printf("4. Update Student\n");
+    fb_printf("5. Delete Student\n");
+    fb_printf("6. Backup Data\n");
+    fb_printf("7. Restore Data\n");
+    fb_printf("8. Generate Report Card (single)\n");
+    fb_printf("9. Analytics & Statistics\n");
+    fb_printf("10. Show Topper & Ranking\n");
+    fb_printf("11. Configure Subjects\n");
+    fb_printf("12. Admin Menu (change password)\n");
+    fb_printf("13. Bulk Import Students\n");
+    fb_printf("14. Generate All Report Cards\n");
+    fb_printf("15. Operation Statistics\n");
+    fb_printf("0. Exit\n");
+    fb_printf(COL_YELLOW "Enter your choice: " COL_RESET);
+    fb_flush();
 }
 
 void admin_submenu() {
     if (!admin_login()) return;
     while (1) {
-        clear_screen();
-        printf(COL_CYAN "----- Admin Menu -----\n" COL_RESET);
-        printf("1. Change Admin Password\n");
-        printf("2. Configure Subjects\n");
-        printf("9. Back\n");
-        printf("Enter choice: ");
+        fb_clear();
+        fb_printf(COL_CYAN "----- Admin Menu -----\n" COL_RESET);
+        fb_printf("1. Change Admin Password\n");
+        fb_printf("2. Configure Subjects\n");
+        fb_printf("3. Compact Data File\n");
+        fb_printf("4. Migrate Legacy Data File\n");
+        fb_printf("5. Storage Engine (file / log)\n");
+        fb_printf("9. Back\n");
+        fb_printf("Enter choice: ");
+        fb_flush();
         int ch;
         if (scanf("%d", &ch) != 1) { while (getchar()!='\n'); continue; }
         while (getchar() != '\n');
         if (ch == 1) change_admin_password();
         else if (ch == 2) configure_subjects();
+        else if (ch == 3) compact_feature();
+        else if (ch == 4) migrate_feature();
+        else if (ch == 5) storage_feature();
         else if (ch == 9) break;
         else printf("Invalid choice.\n");
         pause_anykey();
     }
 }
 
-int main() {
+int main(int argc, char **argv) {
+    if (argc > 1) return cli_main(argc, argv);
+
+    enable_ansi_terminal();
     show_welcome_screen();
     load_subjects();
+    load_storage_mode();
+    data_file_open_check();
+    log_recover();
+    journal_recover();
+    atexit(metrics_at_exit);
+    atexit(journal_flush_at_exit);
     ensure_admin_file();
     ensure_reports_dir();
 
     while (1) {
-        clear_screen();
         show_main_menu();
         int choice;
         if (scanf("%d", &choice) != 1) { printf("Invalid input.\n"); while (getchar()!='\n'); pause_anykey(); continue; }
@@ -796,6 +7054,9 @@ int main() {
             case 10: show_topper_and_ranking(); break;
             case 11: configure_subjects(); break;
             case 12: admin_submenu(); break;
+            case 13: import_feature(); break;
+            case 14: generate_all_reports_feature(); break;
+            case 15: stats_feature(); break;
             case 0: printf(COL_GREEN "Exiting. Goodbye!\n" COL_RESET); exit(0);
             default: printf(COL_RED "Invalid choice. Try again.\n" COL_RESET); pause_anykey(); break;
         }